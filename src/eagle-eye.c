@@ -3,12 +3,14 @@
 #include <gtk/gtk.h>
 #include <ee-main-window.h>
 #include <ee-settings.h>
+#include <ee-trace.h>
 
 int
 main (int argc, char *argv[])
 {
     EESettings *settings;
     GtkWindow *window;
+    gint n_monitors, i;
 
     /* we need to initialize threading before using webkit */
     g_thread_init (NULL);
@@ -22,18 +24,31 @@ main (int argc, char *argv[])
         return 1;
 
     /* prepend URLs listed on the command line in reverse order */
+    ee_settings_begin_batch (settings);
     for (argc--; argc > 0; argc--)
-        ee_settings_insert_url_from_string (settings, argv[argc], 0);
-
-    /* create the main window */
-    window = ee_main_window_construct (settings);
+        if (ee_settings_insert_url_from_string (settings, argv[argc], 0))
+            ee_settings_changed (settings, EE_SETTINGS_URLS);
+    ee_settings_commit_batch (settings);
+
+    /* create the main window, or one per monitor which all share the
+     * settings and network stack */
+    n_monitors = gdk_screen_get_n_monitors (gdk_screen_get_default ());
+    if (settings->multi_monitor && n_monitors > 1) {
+        for (i = 0; i < n_monitors; i++)
+            window = ee_main_window_construct (settings, i, n_monitors);
+    }
+    else
+        window = ee_main_window_construct (settings, -1, 1);
 
     /* hand control over to gtk main loop */
     gtk_main ();
 
-    /* save settings to disk*/
-    ee_settings_save (settings);
+    /* write any unsaved settings to disk, and wait for the writes to finish */
+    ee_settings_flush (settings);
     ee_settings_free (settings);
 
+    /* write the trace, now that the persistence thread has stopped */
+    ee_trace_stop ();
+
     return 0;
 }
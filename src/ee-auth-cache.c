@@ -0,0 +1,303 @@
+#include <string.h>
+#include <glib.h>
+#include <libsoup/soup.h>
+#include <ee-auth-cache.h>
+
+/* marks a message which was sent with credentials before being asked */
+#define EE_AUTH_CACHE_PREEMPTIVE "ee-auth-preemptive"
+
+/*
+ * free_credentials: free a credentials entry.  the user and password
+ *   belong to the playlist arena.
+ */
+static void
+free_credentials (EEAuthCredentials *creds)
+{
+    g_free (creds->authorization);
+    g_free (creds);
+}
+
+/*
+ * make_origin: returns the origin of a URL, which credentials are cached
+ *   under.  credentials given for one scheme or port are never sent to
+ *   another, so a password given over https doesn't go out in the clear
+ *   over http, or to a different service on the same host.  host names
+ *   are case insensitive.  returns NULL if host is NULL.
+ */
+static gchar *
+make_origin (const gchar *scheme, const gchar *host, guint port)
+{
+    gchar *origin, *lower;
+
+    if (scheme == NULL || host == NULL)
+        return NULL;
+    lower = g_ascii_strdown (host, -1);
+    origin = g_strdup_printf ("%s://%s:%u", scheme, lower, port);
+    g_free (lower);
+    return origin;
+}
+
+/*
+ * make_message_origin: returns the origin message is going to.
+ */
+static gchar *
+make_message_origin (SoupMessage *message)
+{
+    SoupURI *uri = soup_message_get_uri (message);
+
+    return make_origin (uri->scheme, uri->host, uri->port);
+}
+
+/*
+ * make_key: returns the hash table key for origin, and realm if it isn't
+ *   NULL.
+ */
+static gchar *
+make_key (const gchar *origin, const gchar *realm)
+{
+    if (realm == NULL)
+        return g_strdup (origin);
+    return g_strdup_printf ("%s\n%s", origin, realm);
+}
+
+/*
+ * lookup: returns the credentials for origin in realm, falling back to the
+ *   credentials for origin in any realm, or NULL if there are none.
+ */
+static EEAuthCredentials *
+lookup (EEAuthCache *cache, const gchar *origin, const gchar *realm)
+{
+    EEAuthCredentials *creds = NULL;
+    gchar *key;
+
+    if (origin == NULL)
+        return NULL;
+    if (realm) {
+        key = make_key (origin, realm);
+        creds = (EEAuthCredentials *) g_hash_table_lookup (cache->origins, key);
+        g_free (key);
+    }
+    if (creds == NULL) {
+        key = make_key (origin, NULL);
+        creds = (EEAuthCredentials *) g_hash_table_lookup (cache->origins, key);
+        g_free (key);
+    }
+    return creds;
+}
+
+/*
+ * insert: store a copy of creds for origin in realm (or any realm if realm
+ *   is NULL), replacing what was there.
+ */
+static EEAuthCredentials *
+insert (EEAuthCache *cache, const gchar *origin, const gchar *realm, EEAuthCredentials *creds)
+{
+    EEAuthCredentials *copy;
+
+    copy = g_new0 (EEAuthCredentials, 1);
+    copy->user = creds->user;
+    copy->password = creds->password;
+    copy->authorization = g_strdup (creds->authorization);
+    g_hash_table_replace (cache->origins, make_key (origin, realm), copy);
+    return copy;
+}
+
+/*
+ * has_credentials: returns TRUE if the URL text has a userinfo part.  this
+ *   is checked before parsing, so only the entries with credentials are
+ *   parsed when the cache is built.
+ */
+static gboolean
+has_credentials (const gchar *text)
+{
+    const gchar *p;
+
+    p = strstr (text, "://");
+    if (p == NULL)
+        return FALSE;
+    for (p += 3; *p && *p != '/' && *p != '?' && *p != '#'; p++)
+        if (*p == '@')
+            return TRUE;
+    return FALSE;
+}
+
+/*
+ * on_request_queued: if the origin has asked for Basic authentication
+ *   before, then send the credentials with the first request, rather than
+ *   waiting to be challenged for them.  digest authentication can't be
+ *   done up front, since it needs a nonce from the server.
+ */
+static void
+on_request_queued (SoupSession *        session,
+                   SoupMessage *        message,
+                   EEAuthCache *        cache)
+{
+    EEAuthCredentials *creds;
+    gchar *origin;
+
+    origin = make_message_origin (message);
+    creds = lookup (cache, origin, NULL);
+    g_free (origin);
+    if (creds == NULL || creds->authorization == NULL)
+        return;
+    if (soup_message_headers_get_one (message->request_headers, "Authorization"))
+        return;
+    soup_message_headers_replace (message->request_headers, "Authorization", creds->authorization);
+    g_object_set_data (G_OBJECT (message), EE_AUTH_CACHE_PREEMPTIVE, GINT_TO_POINTER (TRUE));
+    cache->preemptive++;
+}
+
+/*
+ * on_request_unqueued: a request which was sent with credentials and
+ *   wasn't challenged saved a round trip.
+ */
+static void
+on_request_unqueued (SoupSession *      session,
+                     SoupMessage *      message,
+                     EEAuthCache *      cache)
+{
+    if (g_object_get_data (G_OBJECT (message), EE_AUTH_CACHE_PREEMPTIVE) &&
+        message->status_code != SOUP_STATUS_UNAUTHORIZED)
+        cache->saved++;
+}
+
+/*
+ * ee_auth_cache_new: create a credentials cache, indexed by origin, holding
+ *   the credentials of every entry in the playlist which has them.  if
+ *   several entries for an origin have credentials, the first one wins.
+ */
+EEAuthCache *
+ee_auth_cache_new (EEPlaylist *playlist)
+{
+    EEAuthCache *cache;
+    EEUrl *url;
+    guint i;
+
+    cache = g_new0 (EEAuthCache, 1);
+    cache->origins = g_hash_table_new_full (g_str_hash, g_str_equal,
+        g_free, (GDestroyNotify) free_credentials);
+    for (i = 0; i < ee_playlist_length (playlist); i++) {
+        if (!has_credentials (ee_playlist_get (playlist, i)->text))
+            continue;
+        url = ee_playlist_get_parsed (playlist, i);
+        if (url)
+            ee_auth_cache_add_url (cache, url);
+    }
+    g_debug ("indexed credentials for %u origins", g_hash_table_size (cache->origins));
+    return cache;
+}
+
+/*
+ * ee_auth_cache_attach: send cached credentials with requests made by
+ *   session, once an origin has shown that it accepts them.
+ */
+void
+ee_auth_cache_attach (EEAuthCache *cache, SoupSession *session)
+{
+    g_signal_connect (session, "request-queued",
+        G_CALLBACK (on_request_queued), cache);
+    g_signal_connect (session, "request-unqueued",
+        G_CALLBACK (on_request_unqueued), cache);
+}
+
+/*
+ * ee_auth_cache_add_url: add the credentials of url to the cache, unless
+ *   the cache already has credentials for its origin.
+ */
+void
+ee_auth_cache_add_url (EEAuthCache *cache, EEUrl *url)
+{
+    EEAuthCredentials creds;
+    gchar *origin;
+
+    if (url->host == NULL || url->user == NULL || url->password == NULL)
+        return;
+    origin = make_origin (url->scheme, url->host, url->port);
+    if (lookup (cache, origin, NULL) == NULL) {
+        creds.user = url->user;
+        creds.password = url->password;
+        creds.authorization = NULL;
+        insert (cache, origin, NULL, &creds);
+    }
+    g_free (origin);
+}
+
+/*
+ * ee_auth_cache_authenticate: answer an authentication challenge for
+ *   message with the credentials cached for its origin, whichever entry the
+ *   request belongs to.  if retrying, then the credentials were rejected,
+ *   so they are dropped rather than being sent again.  returns TRUE if
+ *   auth was authenticated.
+ */
+gboolean
+ee_auth_cache_authenticate (EEAuthCache *cache, SoupMessage *message, SoupAuth *auth,
+                            gboolean retrying)
+{
+    EEAuthCredentials *creds;
+    const gchar *realm;
+    gchar *origin, *token, *encoded, *key;
+
+    /* a challenged request didn't save anything, even if it was sent with
+     * credentials up front */
+    g_object_set_data (G_OBJECT (message), EE_AUTH_CACHE_PREEMPTIVE, NULL);
+
+    origin = make_message_origin (message);
+    realm = soup_auth_get_realm (auth);
+    creds = lookup (cache, origin, realm);
+    if (retrying) {
+        if (creds) {
+            g_debug ("credentials for %s were rejected, forgetting them", origin);
+            key = make_key (origin, realm);
+            g_hash_table_remove (cache->origins, key);
+            g_free (key);
+            key = make_key (origin, NULL);
+            g_hash_table_remove (cache->origins, key);
+            g_free (key);
+        }
+        cache->rejected++;
+        creds = NULL;
+    } else
+        cache->challenges++;
+    if (creds == NULL) {
+        g_free (origin);
+        return FALSE;
+    }
+    soup_auth_authenticate (auth, creds->user, creds->password);
+
+    /* remember the realm, and if the origin uses Basic authentication,
+     * then later requests can carry the credentials from the start */
+    creds = insert (cache, origin, realm, creds);
+    if (!g_ascii_strcasecmp (soup_auth_get_scheme_name (auth), "Basic")) {
+        token = g_strdup_printf ("%s:%s", creds->user, creds->password);
+        encoded = g_base64_encode ((const guchar *) token, strlen (token));
+        g_free (creds->authorization);
+        creds->authorization = g_strdup_printf ("Basic %s", encoded);
+        g_free (encoded);
+        g_free (token);
+        insert (cache, origin, NULL, creds);
+    }
+    g_free (origin);
+    return TRUE;
+}
+
+/*
+ * ee_auth_cache_get_stats: returns a newly allocated summary of the
+ *   counters.
+ */
+gchar *
+ee_auth_cache_get_stats (EEAuthCache *cache)
+{
+    return g_strdup_printf ("HTTP auth: %u challenges (%u rejected), "
+        "%u requests sent credentials up front, %u round trips saved",
+        cache->challenges, cache->rejected, cache->preemptive, cache->saved);
+}
+
+/*
+ * ee_auth_cache_free: free the cache.
+ */
+void
+ee_auth_cache_free (EEAuthCache *cache)
+{
+    g_hash_table_destroy (cache->origins);
+    g_free (cache);
+}
@@ -0,0 +1,30 @@
+#ifndef EE_AUTH_CACHE_H
+#define EE_AUTH_CACHE_H
+
+#include <glib.h>
+#include <libsoup/soup.h>
+#include <ee-playlist.h>
+
+typedef struct {
+    const gchar *user;
+    const gchar *password;
+    gchar *authorization;
+} EEAuthCredentials;
+
+typedef struct {
+    GHashTable *origins;
+    guint challenges;
+    guint rejected;
+    guint preemptive;
+    guint saved;
+} EEAuthCache;
+
+EEAuthCache *ee_auth_cache_new (EEPlaylist *playlist);
+void ee_auth_cache_attach (EEAuthCache *cache, SoupSession *session);
+void ee_auth_cache_add_url (EEAuthCache *cache, EEUrl *url);
+gboolean ee_auth_cache_authenticate (EEAuthCache *cache, SoupMessage *message, SoupAuth *auth,
+                                     gboolean retrying);
+gchar *ee_auth_cache_get_stats (EEAuthCache *cache);
+void ee_auth_cache_free (EEAuthCache *cache);
+
+#endif
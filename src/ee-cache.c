@@ -0,0 +1,162 @@
+#include <glib.h>
+#include <libsoup/soup.h>
+#include <ee-cache.h>
+
+#define EE_CACHE_SENT "ee-cache-sent"
+#define EE_CACHE_REQUEST "ee-cache-request"
+
+/* what a request was before the session got it, see ee_cache_tag_request */
+enum {
+    EE_CACHE_OTHER,
+    EE_CACHE_PAGE,
+    EE_CACHE_PAGE_CONDITIONAL
+};
+
+/*
+ * is_conditional: returns TRUE if message asks the server whether a
+ *   cached response is still valid.
+ */
+static gboolean
+is_conditional (SoupMessage *message)
+{
+    return soup_message_headers_get_one (message->request_headers, "If-None-Match")
+        || soup_message_headers_get_one (message->request_headers, "If-Modified-Since");
+}
+
+/*
+ * on_request_queued: callback when a request is handed to the session.
+ *   a page request which is already conditional is WebKit revalidating
+ *   its own copy, not the HTTP cache.
+ */
+static void
+on_request_queued (SoupSession *        session,
+                   SoupMessage *        message,
+                   EECache *            cache)
+{
+    if (GPOINTER_TO_INT (g_object_get_data (G_OBJECT (message), EE_CACHE_REQUEST)) == EE_CACHE_PAGE
+        && is_conditional (message))
+        g_object_set_data (G_OBJECT (message), EE_CACHE_REQUEST,
+            GINT_TO_POINTER (EE_CACHE_PAGE_CONDITIONAL));
+}
+
+/*
+ * on_request_started: callback when the session sends a request to the
+ *   server.  responses the cache serves itself never get here.
+ */
+static void
+on_request_started (SoupSession *       session,
+                    SoupMessage *       message,
+                    SoupSocket *        socket,
+                    EECache *           cache)
+{
+    g_object_set_data (G_OBJECT (message), EE_CACHE_SENT, GINT_TO_POINTER (TRUE));
+}
+
+/*
+ * on_request_unqueued: update the counters for a finished request.  a
+ *   page request which was never sent was answered by the cache, either
+ *   because its copy was fresh or after the server confirmed it with a
+ *   304, and one which was sent is a miss.  the cache revalidates with a
+ *   conditional request of its own, which is counted as a revalidation.
+ *   conditional requests WebKit made itself, and requests which were
+ *   cancelled or failed, aren't counted.
+ */
+static void
+on_request_unqueued (SoupSession *      session,
+                     SoupMessage *      message,
+                     EECache *          cache)
+{
+    if (message->status_code == SOUP_STATUS_NONE
+        || SOUP_STATUS_IS_TRANSPORT_ERROR (message->status_code))
+        return;
+    switch (GPOINTER_TO_INT (g_object_get_data (G_OBJECT (message), EE_CACHE_REQUEST))) {
+        case EE_CACHE_PAGE:
+            if (g_object_get_data (G_OBJECT (message), EE_CACHE_SENT))
+                cache->misses++;
+            else
+                cache->hits++;
+            break;
+        case EE_CACHE_OTHER:
+            if (is_conditional (message)) {
+                cache->revalidations++;
+                if (message->status_code == SOUP_STATUS_NOT_MODIFIED)
+                    cache->not_modified++;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+/*
+ * ee_cache_new: create a persistent HTTP cache in dir, holding at most
+ *   max_size megabytes, and load the index left by the previous run.
+ */
+EECache *
+ee_cache_new (const gchar *dir, guint max_size)
+{
+    EECache *cache;
+
+    cache = g_new0 (EECache, 1);
+    cache->cache = soup_cache_new (dir, SOUP_CACHE_SINGLE_USER);
+    soup_cache_set_max_size (cache->cache, max_size * 1024 * 1024);
+    soup_cache_load (cache->cache);
+    g_debug ("opened HTTP cache in %s (%u MB)", dir, max_size);
+    return cache;
+}
+
+/*
+ * ee_cache_attach: make session use the cache.  the cache revalidates
+ *   stale responses with If-None-Match or If-Modified-Since, depending on
+ *   whether the server sent an ETag or Last-Modified.
+ */
+void
+ee_cache_attach (EECache *cache, SoupSession *session)
+{
+    soup_session_add_feature (session, SOUP_SESSION_FEATURE (cache->cache));
+    g_signal_connect (session, "request-queued",
+        G_CALLBACK (on_request_queued), cache);
+    g_signal_connect (session, "request-started",
+        G_CALLBACK (on_request_started), cache);
+    g_signal_connect (session, "request-unqueued",
+        G_CALLBACK (on_request_unqueued), cache);
+}
+
+/*
+ * ee_cache_tag_request: mark message as requested by a page, before it is
+ *   queued.  only page requests are counted as hits and misses, the
+ *   conditional requests the cache makes to revalidate them aren't.
+ */
+void
+ee_cache_tag_request (EECache *cache, SoupMessage *message)
+{
+    g_object_set_data (G_OBJECT (message), EE_CACHE_REQUEST, GINT_TO_POINTER (EE_CACHE_PAGE));
+}
+
+/*
+ * ee_cache_get_stats: returns a newly allocated summary of the counters.
+ */
+gchar *
+ee_cache_get_stats (EECache *cache)
+{
+    return g_strdup_printf ("HTTP cache: %u hits, %u revalidated (%u not modified), %u misses",
+        cache->hits, cache->revalidations, cache->not_modified, cache->misses);
+}
+
+/*
+ * ee_cache_free: write the cache index to disk, so the next run starts
+ *   with a warm cache, and free the cache.
+ */
+void
+ee_cache_free (EECache *cache)
+{
+    gchar *stats;
+
+    stats = ee_cache_get_stats (cache);
+    g_debug ("%s", stats);
+    g_free (stats);
+    soup_cache_flush (cache->cache);
+    soup_cache_dump (cache->cache);
+    g_object_unref (cache->cache);
+    g_free (cache);
+}
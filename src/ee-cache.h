@@ -0,0 +1,23 @@
+#ifndef EE_CACHE_H
+#define EE_CACHE_H
+
+#include <glib.h>
+#include <libsoup/soup.h>
+#define LIBSOUP_USE_UNSTABLE_REQUEST_API
+#include <libsoup/soup-cache.h>
+
+typedef struct {
+    SoupCache *cache;
+    guint hits;
+    guint revalidations;
+    guint not_modified;
+    guint misses;
+} EECache;
+
+EECache *ee_cache_new (const gchar *dir, guint max_size);
+void ee_cache_attach (EECache *cache, SoupSession *session);
+void ee_cache_tag_request (EECache *cache, SoupMessage *message);
+gchar *ee_cache_get_stats (EECache *cache);
+void ee_cache_free (EECache *cache);
+
+#endif
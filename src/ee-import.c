@@ -0,0 +1,217 @@
+#include <string.h>
+#include <glib.h>
+#include <libsoup/soup.h>
+#include <ee-import.h>
+#include <ee-playlist.h>
+
+/* how many bytes to parse between progress updates */
+#define EE_IMPORT_PROGRESS_STEP (16 * 1024)
+
+/*
+ * free_entry: free an imported entry.
+ */
+static void
+free_entry (EEImportEntry *entry)
+{
+    g_free (entry->url);
+    g_free (entry->user);
+    g_free (entry->password);
+    g_free (entry);
+}
+
+/*
+ * parse_url: parse text, and return the URL as it is shown in the URL
+ *   manager, or NULL if text is not a valid HTTP URL.  the parsed URI is
+ *   returned in uri.
+ */
+static gchar *
+parse_url (const gchar *text, SoupURI **uri)
+{
+    SoupURI *u;
+
+    u = soup_uri_new (text);
+    if (u == NULL)
+        return NULL;
+    if (!SOUP_URI_VALID_FOR_HTTP (u)) {
+        soup_uri_free (u);
+        return NULL;
+    }
+    *uri = u;
+    return soup_uri_to_string (u, FALSE);
+}
+
+/*
+ * import_thread: parse and validate each line of the import, dropping
+ *   invalid URLs and URLs which are already in the playlist or appeared
+ *   earlier in the import.  URLs are compared the same way the playlist
+ *   compares them, see ee_url_normalize.
+ */
+static gpointer
+import_thread (EEImport *import)
+{
+    GHashTable *seen;
+    GError *error = NULL;
+    gchar *s, *end, *eol, *url, *key;
+    SoupURI *uri;
+    EEImportEntry *entry;
+    gint reported = 0;
+    guint i;
+
+    /* read the file here rather than in the main loop */
+    if (import->filename) {
+        g_free (import->text);
+        import->text = NULL;
+        if (!g_file_get_contents (import->filename, &import->text, NULL, &error)) {
+            import->error = g_strdup (error->message);
+            g_error_free (error);
+            g_atomic_int_set (&import->done, TRUE);
+            return NULL;
+        }
+    }
+    g_atomic_int_set (&import->total, (gint) strlen (import->text));
+
+    /* the URLs already in the playlist count as seen */
+    seen = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    for (i = 0; i < import->existing->len; i++) {
+        key = ee_url_normalize (g_ptr_array_index (import->existing, i), -1);
+        g_hash_table_insert (seen, key, key);
+    }
+
+    s = import->text;
+    end = s + strlen (s);
+    while (s < end && !g_atomic_int_get (&import->cancelled)) {
+        eol = strchr (s, '\n');
+        if (eol == NULL)
+            eol = end;
+        *eol = '\0';
+        /* remove leading and trailing whitespace */
+        s = g_strstrip (s);
+        /* if string is empty or starts with a '#', then ignore it */
+        if (s[0] == '\0' || s[0] == '#')
+            ;
+        else if ((url = parse_url (s, &uri)) == NULL)
+            import->ninvalid++;
+        else if (g_hash_table_lookup (seen, (key = ee_url_normalize (s, -1)))) {
+            import->nduplicate++;
+            g_free (key);
+            g_free (url);
+            soup_uri_free (uri);
+        }
+        else {
+            g_hash_table_insert (seen, key, key);
+            entry = g_new0 (EEImportEntry, 1);
+            entry->url = url;
+            entry->user = g_strdup (uri->user);
+            entry->password = g_strdup (uri->password);
+            g_ptr_array_add (import->entries, entry);
+            soup_uri_free (uri);
+        }
+        s = eol + 1;
+        if (s - import->text - reported >= EE_IMPORT_PROGRESS_STEP) {
+            reported = s - import->text;
+            g_atomic_int_set (&import->processed, reported);
+        }
+    }
+
+    g_hash_table_destroy (seen);
+    g_atomic_int_set (&import->processed, g_atomic_int_get (&import->total));
+    g_atomic_int_set (&import->done, TRUE);
+    return NULL;
+}
+
+/*
+ * ee_import_start: start parsing URLs on a worker thread, one URL per line,
+ *   from filename if it is not NULL, otherwise from text.  the import takes
+ *   ownership of text and existing, which holds the URLs already in the
+ *   playlist.  returns NULL if the thread couldn't be created.
+ */
+EEImport *
+ee_import_start (const gchar *filename, gchar *text, GPtrArray *existing)
+{
+    EEImport *import;
+    GError *error = NULL;
+
+    import = g_new0 (EEImport, 1);
+    import->filename = g_strdup (filename);
+    import->text = text ? text : g_strdup ("");
+    import->existing = existing ? existing : g_ptr_array_new ();
+    import->entries = g_ptr_array_new ();
+    import->thread = g_thread_create ((GThreadFunc) import_thread, import, TRUE, &error);
+    if (import->thread == NULL) {
+        g_critical ("failed to start import thread: %s", error->message);
+        g_error_free (error);
+        ee_import_free (import);
+        return NULL;
+    }
+    return import;
+}
+
+/*
+ * ee_import_get_progress: returns the fraction of the input parsed so far.
+ */
+gdouble
+ee_import_get_progress (EEImport *import)
+{
+    gint total = g_atomic_int_get (&import->total);
+
+    if (total == 0)
+        return 0.0;
+    return (gdouble) g_atomic_int_get (&import->processed) / total;
+}
+
+/*
+ * ee_import_is_done: returns TRUE once the worker thread has finished,
+ *   at which point ee_import_finish won't block.
+ */
+gboolean
+ee_import_is_done (EEImport *import)
+{
+    return g_atomic_int_get (&import->done);
+}
+
+/*
+ * ee_import_cancel: ask the worker thread to stop early.
+ */
+void
+ee_import_cancel (EEImport *import)
+{
+    g_atomic_int_set (&import->cancelled, TRUE);
+}
+
+/*
+ * ee_import_finish: wait for the worker thread to exit.  afterwards the
+ *   results can be read from the import.
+ */
+void
+ee_import_finish (EEImport *import)
+{
+    if (import->thread) {
+        g_thread_join (import->thread);
+        import->thread = NULL;
+    }
+}
+
+/*
+ * ee_import_free: wait for the worker thread to exit, and free the import
+ *   and its results.
+ */
+void
+ee_import_free (EEImport *import)
+{
+    guint i;
+
+    ee_import_cancel (import);
+    ee_import_finish (import);
+    for (i = 0; i < import->entries->len; i++)
+        free_entry (g_ptr_array_index (import->entries, i));
+    g_ptr_array_free (import->entries, TRUE);
+    if (import->existing) {
+        for (i = 0; i < import->existing->len; i++)
+            g_free (g_ptr_array_index (import->existing, i));
+        g_ptr_array_free (import->existing, TRUE);
+    }
+    g_free (import->filename);
+    g_free (import->text);
+    g_free (import->error);
+    g_free (import);
+}
@@ -0,0 +1,34 @@
+#ifndef EE_IMPORT_H
+#define EE_IMPORT_H
+
+#include <glib.h>
+
+typedef struct {
+    gchar *url;
+    gchar *user;
+    gchar *password;
+} EEImportEntry;
+
+typedef struct {
+    GThread *thread;
+    gchar *filename;
+    gchar *text;
+    GPtrArray *existing;
+    GPtrArray *entries;
+    guint ninvalid;
+    guint nduplicate;
+    gchar *error;
+    volatile gint total;
+    volatile gint processed;
+    volatile gint cancelled;
+    volatile gint done;
+} EEImport;
+
+EEImport *ee_import_start (const gchar *filename, gchar *text, GPtrArray *existing);
+gdouble ee_import_get_progress (EEImport *import);
+gboolean ee_import_is_done (EEImport *import);
+void ee_import_cancel (EEImport *import);
+void ee_import_finish (EEImport *import);
+void ee_import_free (EEImport *import);
+
+#endif
@@ -0,0 +1,440 @@
+#include <string.h>
+#include <errno.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <libsoup/soup.h>
+#include <webkit/webkit.h>
+#include <ee-load-log.h>
+
+/* webview data holding the timing of the page being loaded */
+#define EE_LOAD_LOG_TIMING "ee-load-timing"
+/* message data holding the webview which made the request, and the page
+ * load it was made for */
+#define EE_LOAD_LOG_WEBVIEW "ee-load-webview"
+#define EE_LOAD_LOG_GENERATION "ee-load-generation"
+/* message data marking a message whose body is already being counted */
+#define EE_LOAD_LOG_COUNTED "ee-load-counted"
+
+/* how many rotated logs are kept, as path.1 (the newest) to path.N */
+#define EE_LOAD_LOG_KEEP 3
+/* buffered records are appended to the log once there are this many bytes
+ * of them, or every EE_LOAD_LOG_FLUSH_INTERVAL seconds */
+#define EE_LOAD_LOG_FLUSH_SIZE 4096
+#define EE_LOAD_LOG_FLUSH_INTERVAL 60
+
+#define EE_LOAD_LOG_HEADER \
+    "time,url,outcome,first_byte_ms,first_layout_ms,end_ms,requests,bytes\n"
+
+typedef struct {
+    EELoadLog *log;
+    gchar *url;
+    guint generation;
+    gint64 start;
+    gint64 first_byte;
+    gint64 first_layout;
+    gint64 end;
+    gboolean cancelled;
+    gboolean timed_out;
+    gboolean done;
+    guint requests;
+    guint64 bytes;
+} EELoadTiming;
+
+/*
+ * get_time: returns the monotonic time in microseconds.
+ */
+static gint64
+get_time (void)
+{
+    return g_get_monotonic_time ();
+}
+
+/*
+ * free_timing: free the timing of a webview which is being finalized.
+ */
+static void
+free_timing (EELoadTiming *timing)
+{
+    g_free (timing->url);
+    g_free (timing);
+}
+
+/*
+ * append_interval: append the milliseconds from the navigation start to t
+ *   as a field, or an empty field if t never happened.
+ */
+static void
+append_interval (GString *buffer, EELoadTiming *timing, gint64 t)
+{
+    if (t > 0)
+        g_string_append_printf (buffer, "%" G_GINT64_FORMAT ",", (t - timing->start) / 1000);
+    else
+        g_string_append_c (buffer, ',');
+}
+
+/*
+ * write_record: add a record for the page load to the log, and pass it to
+ *   the log's function.  only the first outcome of each load is recorded.
+ */
+static void
+write_record (EELoadTiming *timing, const gchar *outcome)
+{
+    EELoadLog *log = timing->log;
+    const gchar *s;
+
+    if (timing->done || timing->start == 0)
+        return;
+    timing->done = TRUE;
+    /* blank pages aren't worth recording */
+    if (timing->url == NULL || g_str_has_prefix (timing->url, "about:"))
+        return;
+
+    g_debug ("%s %s in %" G_GINT64_FORMAT " ms (%u requests, %" G_GUINT64_FORMAT " bytes)",
+        timing->url, outcome, (timing->end - timing->start) / 1000, timing->requests, timing->bytes);
+    if (log->func)
+        log->func (timing->url, outcome, timing->end - timing->start,
+            timing->requests, timing->bytes, log->func_data);
+    if (log->path == NULL)
+        return;
+
+    g_string_append_printf (log->buffer, "%" G_GINT64_FORMAT ",\"",
+        g_get_real_time () / G_USEC_PER_SEC);
+    /* quotes in a CSV field are escaped by doubling them */
+    for (s = timing->url; *s; s++) {
+        if (*s == '"')
+            g_string_append_c (log->buffer, '"');
+        g_string_append_c (log->buffer, *s);
+    }
+    g_string_append_printf (log->buffer, "\",%s,", outcome);
+    append_interval (log->buffer, timing, timing->first_byte);
+    append_interval (log->buffer, timing, timing->first_layout);
+    append_interval (log->buffer, timing, timing->end);
+    g_string_append_printf (log->buffer, "%u,%" G_GUINT64_FORMAT "\n", timing->requests, timing->bytes);
+    if (log->buffer->len >= EE_LOAD_LOG_FLUSH_SIZE)
+        ee_load_log_flush (log);
+}
+
+/*
+ * get_provisional_uri: returns the URL the main frame of webview has
+ *   started loading, or NULL if it isn't known.
+ */
+static const gchar *
+get_provisional_uri (WebKitWebView *webview)
+{
+    WebKitWebDataSource *source;
+    WebKitNetworkRequest *request;
+
+    source = webkit_web_frame_get_provisional_data_source (webkit_web_view_get_main_frame (webview));
+    if (source == NULL)
+        return NULL;
+    request = webkit_web_data_source_get_initial_request (source);
+    return request ? webkit_network_request_get_uri (request) : NULL;
+}
+
+/*
+ * on_load_status: callback when the load status of the main frame
+ *   changes, which is when each of the page timings is taken.
+ */
+static void
+on_load_status (WebKitWebView *         webview,
+                GParamSpec *            pspec,
+                EELoadTiming *          timing)
+{
+    gint64 now = get_time ();
+
+    switch (webkit_web_view_get_load_status (webview)) {
+        case WEBKIT_LOAD_PROVISIONAL:
+            /* a new load replaces one which never finished */
+            if (!timing->done)
+                timing->end = now;
+            write_record (timing, timing->timed_out ? "timeout" : "cancelled");
+            g_free (timing->url);
+            timing->url = g_strdup (get_provisional_uri (webview));
+            timing->generation++;
+            timing->start = now;
+            timing->first_byte = 0;
+            timing->first_layout = 0;
+            timing->end = 0;
+            timing->cancelled = FALSE;
+            timing->timed_out = FALSE;
+            timing->done = FALSE;
+            timing->requests = 0;
+            timing->bytes = 0;
+            break;
+        case WEBKIT_LOAD_COMMITTED:
+            /* responses served without a network request don't have
+             * got-headers, so committing stands in for the first byte */
+            if (timing->first_byte == 0)
+                timing->first_byte = now;
+            g_free (timing->url);
+            timing->url = g_strdup (webkit_web_view_get_uri (webview));
+            break;
+        case WEBKIT_LOAD_FIRST_VISUALLY_NON_EMPTY_LAYOUT:
+            if (timing->first_layout == 0)
+                timing->first_layout = now;
+            break;
+        case WEBKIT_LOAD_FINISHED:
+            timing->end = now;
+            write_record (timing, "ok");
+            break;
+        case WEBKIT_LOAD_FAILED:
+            timing->end = now;
+            if (timing->timed_out)
+                write_record (timing, "timeout");
+            else
+                write_record (timing, timing->cancelled ? "cancelled" : "failed");
+            break;
+    }
+}
+
+/*
+ * on_load_error: note whether a failed load was stopped on purpose, such
+ *   as when the user moves on or a view is reused, rather than failing by
+ *   itself.
+ */
+static gboolean
+on_load_error (WebKitWebView *          webview,
+               WebKitWebFrame *         frame,
+               gchar *                  uri,
+               GError *                 error,
+               EELoadTiming *           timing)
+{
+    if (frame == webkit_web_view_get_main_frame (webview)
+        && error->domain == WEBKIT_NETWORK_ERROR
+        && error->code == WEBKIT_NETWORK_ERROR_CANCELLED)
+        timing->cancelled = TRUE;
+    return FALSE;
+}
+
+/*
+ * get_message_timing: returns the timing of the page load message was
+ *   made for, or NULL if it wasn't tagged or that load is over.
+ */
+static EELoadTiming *
+get_message_timing (SoupMessage *message)
+{
+    GObject *webview;
+    EELoadTiming *timing;
+
+    webview = (GObject *) g_object_get_data (G_OBJECT (message), EE_LOAD_LOG_WEBVIEW);
+    if (webview == NULL)
+        return NULL;
+    timing = (EELoadTiming *) g_object_get_data (webview, EE_LOAD_LOG_TIMING);
+    if (timing == NULL || timing->done || timing->generation !=
+        GPOINTER_TO_UINT (g_object_get_data (G_OBJECT (message), EE_LOAD_LOG_GENERATION)))
+        return NULL;
+    return timing;
+}
+
+/*
+ * on_got_headers: callback when the response headers of a page arrive.
+ */
+static void
+on_got_headers (SoupMessage *message, gpointer data)
+{
+    EELoadTiming *timing = get_message_timing (message);
+
+    if (timing && timing->first_byte == 0)
+        timing->first_byte = get_time ();
+}
+
+/*
+ * on_got_chunk: count the bytes of a response body as they arrive.
+ */
+static void
+on_got_chunk (SoupMessage *message, SoupBuffer *chunk, gpointer data)
+{
+    EELoadTiming *timing = get_message_timing (message);
+
+    if (timing)
+        timing->bytes += chunk->length;
+}
+
+/*
+ * on_request_started: callback when the session sends a request.  only
+ *   requests tagged with a page load are counted.
+ */
+static void
+on_request_started (SoupSession *       session,
+                    SoupMessage *       message,
+                    SoupSocket *        socket,
+                    EELoadLog *         log)
+{
+    EELoadTiming *timing = get_message_timing (message);
+
+    if (timing == NULL)
+        return;
+    timing->requests++;
+    /* a message is started again when it is redirected or retried */
+    if (g_object_get_data (G_OBJECT (message), EE_LOAD_LOG_COUNTED))
+        return;
+    g_object_set_data (G_OBJECT (message), EE_LOAD_LOG_COUNTED, GINT_TO_POINTER (TRUE));
+    g_signal_connect (message, "got-chunk", G_CALLBACK (on_got_chunk), NULL);
+}
+
+/*
+ * on_flush_timeout: append buffered records to the log periodically, so
+ *   they aren't lost if the process dies.
+ */
+static gboolean
+on_flush_timeout (EELoadLog *log)
+{
+    ee_load_log_flush (log);
+    return TRUE;
+}
+
+/*
+ * ee_load_log_new: create a log of page load timings at path, which is
+ *   written by the persist thread.  once the log would grow past max_size
+ *   bytes it is rotated, keeping EE_LOAD_LOG_KEEP old logs.  a max_size of
+ *   0 lets the log grow forever.  if path is NULL, then nothing is
+ *   written, and the timings only go to the log's function.
+ */
+EELoadLog *
+ee_load_log_new (EEPersist *persist, const gchar *path, gsize max_size)
+{
+    EELoadLog *log;
+    struct stat st;
+
+    g_assert (persist != NULL);
+
+    log = g_new0 (EELoadLog, 1);
+    log->persist = persist;
+    log->path = g_strdup (path);
+    log->buffer = g_string_new (NULL);
+    log->max_size = max_size;
+    if (path == NULL)
+        return log;
+    /* records are appended to an existing log */
+    if (g_stat (path, &st) == 0)
+        log->size = st.st_size;
+    else if (errno != ENOENT)
+        g_warning ("failed to stat %s: %s", path, g_strerror (errno));
+    log->flush_id = g_timeout_add_seconds (EE_LOAD_LOG_FLUSH_INTERVAL,
+        (GSourceFunc) on_flush_timeout, log);
+    return log;
+}
+
+/*
+ * ee_load_log_attach: count the requests made for each page, and the bytes
+ *   received for them, on session.
+ */
+void
+ee_load_log_attach (EELoadLog *log, SoupSession *session)
+{
+    g_signal_connect (session, "request-started",
+        G_CALLBACK (on_request_started), log);
+}
+
+/*
+ * ee_load_log_watch: record the timing of every page webview loads.
+ */
+void
+ee_load_log_watch (EELoadLog *log, WebKitWebView *webview)
+{
+    EELoadTiming *timing;
+
+    timing = g_new0 (EELoadTiming, 1);
+    timing->log = log;
+    g_object_set_data_full (G_OBJECT (webview), EE_LOAD_LOG_TIMING, timing,
+        (GDestroyNotify) free_timing);
+    g_signal_connect (webview, "notify::load-status",
+        G_CALLBACK (on_load_status), timing);
+    g_signal_connect (webview, "load-error",
+        G_CALLBACK (on_load_error), timing);
+}
+
+/*
+ * ee_load_log_set_timed_out: note that the load in progress in webview is
+ *   being stopped for taking longer than its load timeout, so it is
+ *   recorded as a timeout rather than as cancelled.
+ */
+void
+ee_load_log_set_timed_out (WebKitWebView *webview)
+{
+    EELoadTiming *timing;
+
+    timing = (EELoadTiming *) g_object_get_data (G_OBJECT (webview), EE_LOAD_LOG_TIMING);
+    if (timing && !timing->done)
+        timing->timed_out = TRUE;
+}
+
+/*
+ * ee_load_log_tag: mark message as a request for the page webview is
+ *   loading, so that it is counted.  document is TRUE if message is the
+ *   request for the page itself, whose response is the first byte.
+ */
+void
+ee_load_log_tag (EELoadLog *log, WebKitWebView *webview, SoupMessage *message, gboolean document)
+{
+    EELoadTiming *timing;
+
+    timing = (EELoadTiming *) g_object_get_data (G_OBJECT (webview), EE_LOAD_LOG_TIMING);
+    if (timing == NULL || message == NULL)
+        return;
+    g_object_set_data_full (G_OBJECT (message), EE_LOAD_LOG_WEBVIEW,
+        g_object_ref (webview), g_object_unref);
+    g_object_set_data (G_OBJECT (message), EE_LOAD_LOG_GENERATION,
+        GUINT_TO_POINTER (timing->generation));
+    if (document)
+        g_signal_connect (message, "got-headers", G_CALLBACK (on_got_headers), NULL);
+}
+
+/*
+ * ee_load_log_set_func: call func with each page load as it is recorded,
+ *   or stop if func is NULL.  duration is in microseconds.
+ */
+void
+ee_load_log_set_func (EELoadLog *log, EELoadLogFunc func, gpointer data)
+{
+    log->func = func;
+    log->func_data = data;
+}
+
+/*
+ * ee_load_log_flush: queue the buffered records to be appended to the log,
+ *   rotating it first if it has grown too big.
+ */
+void
+ee_load_log_flush (EELoadLog *log)
+{
+    gchar *source, *target;
+    gsize len;
+    gint i;
+
+    if (log->buffer->len == 0)
+        return;
+    if (log->max_size > 0 && log->size > 0 && log->size + log->buffer->len > log->max_size) {
+        for (i = EE_LOAD_LOG_KEEP; i > 0; i--) {
+            source = i > 1 ? g_strdup_printf ("%s.%i", log->path, i - 1) : g_strdup (log->path);
+            target = g_strdup_printf ("%s.%i", log->path, i);
+            ee_persist_rename (log->persist, source, target);
+            g_free (source);
+            g_free (target);
+        }
+        g_debug ("rotated %s", log->path);
+        log->size = 0;
+    }
+    /* a new log starts with the column names */
+    if (log->size == 0)
+        g_string_prepend (log->buffer, EE_LOAD_LOG_HEADER);
+    len = log->buffer->len;
+    log->size += len;
+    ee_persist_append (log->persist, log->path, g_string_free (log->buffer, FALSE), len);
+    log->buffer = g_string_new (NULL);
+}
+
+/*
+ * ee_load_log_free: queue any buffered records, and free the log.  the
+ *   persist object must still exist.
+ */
+void
+ee_load_log_free (EELoadLog *log)
+{
+    if (log->flush_id > 0)
+        g_source_remove (log->flush_id);
+    ee_load_log_flush (log);
+    g_string_free (log->buffer, TRUE);
+    g_free (log->path);
+    g_free (log);
+}
@@ -0,0 +1,32 @@
+#ifndef EE_LOAD_LOG_H
+#define EE_LOAD_LOG_H
+
+#include <glib.h>
+#include <libsoup/soup.h>
+#include <webkit/webkit.h>
+#include <ee-persist.h>
+
+typedef void (*EELoadLogFunc) (const gchar *url, const gchar *outcome, gint64 duration,
+                               guint requests, guint64 bytes, gpointer data);
+
+typedef struct {
+    EEPersist *persist;
+    gchar *path;
+    GString *buffer;
+    gsize size;
+    gsize max_size;
+    guint flush_id;
+    EELoadLogFunc func;
+    gpointer func_data;
+} EELoadLog;
+
+EELoadLog *ee_load_log_new (EEPersist *persist, const gchar *path, gsize max_size);
+void ee_load_log_attach (EELoadLog *log, SoupSession *session);
+void ee_load_log_watch (EELoadLog *log, WebKitWebView *webview);
+void ee_load_log_set_timed_out (WebKitWebView *webview);
+void ee_load_log_tag (EELoadLog *log, WebKitWebView *webview, SoupMessage *message, gboolean document);
+void ee_load_log_set_func (EELoadLog *log, EELoadLogFunc func, gpointer data);
+void ee_load_log_flush (EELoadLog *log);
+void ee_load_log_free (EELoadLog *log);
+
+#endif
@@ -3,8 +3,37 @@
 #include <libsoup/soup.h>
 #include <ee-main-window.h>
 #include <ee-settings.h>
+#include <ee-metrics.h>
 #include <ee-prefs-dialog.h>
+#include <ee-trace.h>
 #include <ee-url-manager.h>
+#include <ee-watchdog.h>
+
+/* how long a failing URL is skipped for after its first failure, in seconds.
+ * this doubles with each further failure, up to the maximum. */
+#define EE_MAIN_WINDOW_BACKOFF_MIN 30
+#define EE_MAIN_WINDOW_BACKOFF_MAX 3600
+
+/* an aligned cycle switching further than this from the slot boundary is
+ * warned about, in milliseconds */
+#define EE_MAIN_WINDOW_JITTER_MAX 100
+
+/* webview data holding the render profile the view was last loaded with */
+#define EE_MAIN_WINDOW_PROFILE "ee-profile"
+
+typedef struct {
+    guint count;
+    gint64 retry_after;
+} EEFailure;
+
+/* the open windows, which all share one session, cookie jar and cache */
+static GList *windows = NULL;
+
+/* the metrics endpoint, if metrics-port is set */
+static EEMetrics *metrics = NULL;
+
+/* the main loop watchdog, if watchdog-interval is set */
+static EEWatchdog *watchdog = NULL;
 
 /*
  * on_window_destroy: callback when destroying the main window
@@ -13,22 +42,49 @@ static void
 on_window_destroy (GtkWindow *          window,
                    EEMainWindow *       mainwin)
 {
+    ee_playlist_remove_cursor (mainwin->settings->urls, &mainwin->curr_url);
+    ee_playlist_remove_cursor (mainwin->settings->urls, &mainwin->preload_url);
+    if (mainwin->snapshots)
+        ee_snapshots_free (mainwin->snapshots);
+    if (mainwin->grid)
+        ee_tile_grid_free (mainwin->grid);
+    ee_scheduler_free (mainwin->scheduler);
+    g_hash_table_destroy (mainwin->failures);
+    ee_view_pool_free (mainwin->pool);
+    g_hash_table_destroy (mainwin->profile_settings);
+    windows = g_list_remove (windows, mainwin);
+    /* quit once the last window is closed */
+    if (windows == NULL) {
+        if (metrics) {
+            ee_load_log_set_func (mainwin->settings->loads, NULL, NULL);
+            ee_metrics_free (metrics);
+            metrics = NULL;
+        }
+        if (watchdog) {
+            ee_watchdog_free (watchdog);
+            watchdog = NULL;
+        }
+        gtk_main_quit ();
+    }
     g_free (mainwin);
-    gtk_main_quit ();
 }
 
 /*
- * on_window_configure_event: save the window geometry
+ * on_window_configure_event: save the window geometry.  windows which were
+ *   placed on a monitor are placed there again, so theirs isn't saved.
  */
 static gboolean
 on_window_configure_event (GtkWindow *          window,
                            GdkEventConfigure *  ev,
                            EEMainWindow *       mainwin)
 {
+    if (mainwin->monitor >= 0)
+        return FALSE;
     if (mainwin->settings->window_geometry)
         g_free (mainwin->settings->window_geometry);
     mainwin->settings->window_geometry = g_strdup_printf ("%ix%i+%i+%i",
         ev->width, ev->height, ev->x, ev->y);
+    ee_settings_changed (mainwin->settings, EE_SETTINGS_GEOMETRY);
     return FALSE;
 }
 
@@ -40,38 +96,87 @@ on_load_started (WebKitWebView *        webview,
                  WebKitWebFrame *       frame,
                  EEMainWindow *         mainwin)
 {
-    SoupURI *uri;
-    gchar *uri_string;
+    EEPoolView *view = ee_view_pool_get_view (webview);
+    EEUrl *url;
     gchar *status;
 
-    uri = (SoupURI *) mainwin->curr_url->data;
-    uri_string = soup_uri_to_string (uri, FALSE);
-    status = g_strdup_printf ("loading %s", uri_string);
+    EE_TRACE_INSTANT ("load", "load-started", webkit_web_view_get_uri (webview));
+    if (view)
+        view->failed = FALSE;
+    /* hidden views load behind the scenes, so don't report them */
+    if (webview != mainwin->webview)
+        return;
+    url = ee_playlist_get_parsed (mainwin->settings->urls, mainwin->curr_url);
+    if (url == NULL)
+        return;
+    status = g_strdup_printf ("loading %s", url->display);
     gtk_label_set_text (mainwin->status, status);
     g_free (status);
-    g_free (uri_string);
 }
 
 /*
- * on_http_auth: callback when HTTP authorization is requested
+ * find_credentials: returns the entry whose credentials a request to host
+ *   made by mainwin should use.  that is the entry being preloaded or
+ *   rendered into a snapshot if it is going to host, and otherwise the
+ *   entry being shown.
+ */
+static EEUrl *
+find_credentials (EEMainWindow *mainwin, const gchar *host)
+{
+    EEUrl *creds, *snapshot;
+
+    creds = ee_playlist_get_parsed (mainwin->settings->urls, mainwin->curr_url);
+    /* if the request belongs to the page being preloaded, use its credentials */
+    if (mainwin->preload_url >= 0) {
+        EEUrl *preload = ee_playlist_get_parsed (mainwin->settings->urls, mainwin->preload_url);
+        if (preload && host && preload->host && !g_ascii_strcasecmp (host, preload->host))
+            creds = preload;
+    }
+    /* likewise for the page being rendered into a snapshot */
+    snapshot = mainwin->snapshots ? ee_snapshots_get_current (mainwin->snapshots) : NULL;
+    if (snapshot && host && snapshot->host && !g_ascii_strcasecmp (host, snapshot->host))
+        creds = snapshot;
+    return creds;
+}
+
+/*
+ * on_http_auth: callback when HTTP authorization is requested.  the session
+ *   is shared by all windows, so this is connected once, for all of them.
  */
 static void
 on_http_auth (SoupSession *         session,
               SoupMessage *         message,
               SoupAuth *            auth,
               gboolean              retrying,
-              EEMainWindow *        mainwin)
+              EESettings *          settings)
 {
-    SoupURI *uri, *creds;
+    SoupURI *uri;
+    EEUrl *creds = NULL;
+    GList *item;
 
-    /* retrying is pointless, we just return (which causes the load to fail) */
+    EE_TRACE_INSTANT ("load", "authenticate", soup_message_get_uri (message)->host);
+    /* retrying is pointless, we just return (which causes the load to fail),
+     * but the cache stops sending the rejected credentials */
     if (retrying) {
+        ee_auth_cache_authenticate (settings->auth, message, auth, TRUE);
         g_debug ("HTTP auth was rejected by server");
         return;
     }
+    /* use the credentials for the host the request is going to, whichever
+     * entry the request belongs to */
+    if (ee_auth_cache_authenticate (settings->auth, message, auth, FALSE))
+        return;
+    /* otherwise fall back to the credentials of an entry being loaded, in
+     * the window loading that host if there is one, or else the first */
     uri = soup_message_get_uri (message);
-    creds = (SoupURI *) mainwin->curr_url->data;
-    if (creds->user && creds->password)
+    for (item = windows; item; item = g_list_next (item)) {
+        creds = find_credentials ((EEMainWindow *) item->data, uri->host);
+        if (creds && creds->host && uri->host && !g_ascii_strcasecmp (creds->host, uri->host))
+            break;
+    }
+    if (item == NULL && windows)
+        creds = find_credentials ((EEMainWindow *) windows->data, uri->host);
+    if (creds && creds->user && creds->password)
         soup_auth_authenticate (auth, creds->user, creds->password);
     else
         g_debug ("HTTP auth missing credentials");
@@ -79,14 +184,402 @@ on_http_auth (SoupSession *         session,
 }
 
 /*
- * on_load_finished: callback when we've finished loading a URL
+ * show_view: make the view visible and update the window title to match.
+ */
+static void
+show_view (EEMainWindow *mainwin, EEPoolView *view)
+{
+    const gchar *title;
+    gchar *window_title;
+
+    ee_view_pool_show (mainwin->pool, view);
+    mainwin->visible = view;
+    mainwin->webview = view->webview;
+
+    /* the title-changed signal was ignored while the view was hidden */
+    title = webkit_web_view_get_title (view->webview);
+    if (title) {
+        window_title = g_strdup_printf ("Eagle Eye - %s", title);
+        gtk_window_set_title (mainwin->window, window_title);
+        g_free (window_title);
+    }
+    gtk_label_set_text (mainwin->status, "");
+}
+
+static void start_cycle (EEMainWindow *mainwin);
+static void on_timeout (EEMainWindow *mainwin);
+
+/*
+ * get_time: returns the monotonic time in seconds.
+ */
+static gint64
+get_time (void)
+{
+    return g_get_monotonic_time () / G_USEC_PER_SEC;
+}
+
+/*
+ * record_load: remember whether the URL loaded.  each consecutive failure
+ *   doubles how long the URL is skipped for, and a success forgets them.
+ */
+static void
+record_load (EEMainWindow *mainwin, const gchar *s, gboolean ok)
+{
+    EEFailure *failure;
+    EEUrl *url;
+    guint backoff;
+
+    if (s == NULL)
+        return;
+    url = ee_playlist_get (mainwin->settings->urls,
+        ee_playlist_find (mainwin->settings->urls, s, -1));
+    if (url == NULL)
+        return;
+    failure = (EEFailure *) g_hash_table_lookup (mainwin->failures, url->key);
+    if (ok) {
+        if (failure) {
+            g_debug ("%s loaded again after %u failures", s, failure->count);
+            g_hash_table_remove (mainwin->failures, url->key);
+        }
+        return;
+    }
+    if (failure == NULL) {
+        failure = g_new0 (EEFailure, 1);
+        g_hash_table_insert (mainwin->failures, (gpointer) url->key, failure);
+    }
+    failure->count++;
+    backoff = EE_MAIN_WINDOW_BACKOFF_MIN << MIN (failure->count - 1, 7);
+    backoff = MIN (backoff, EE_MAIN_WINDOW_BACKOFF_MAX);
+    failure->retry_after = get_time () + backoff;
+    g_debug ("%s failed to load %u times, skipping it for %u seconds", s, failure->count, backoff);
+}
+
+/*
+ * is_skipped: returns TRUE if the URL at index has failed recently, and
+ *   shouldn't be shown until it is due to be retried.
+ */
+static gboolean
+is_skipped (EEMainWindow *mainwin, gint index)
+{
+    EEFailure *failure;
+    EEUrl *url;
+
+    if (g_hash_table_size (mainwin->failures) == 0)
+        return FALSE;
+    url = ee_playlist_get (mainwin->settings->urls, index);
+    if (url == NULL)
+        return FALSE;
+    failure = (EEFailure *) g_hash_table_lookup (mainwin->failures, url->key);
+    return failure && get_time () < failure->retry_after;
+}
+
+/*
+ * in_partition: returns TRUE if the URL at index belongs to mainwin.  when
+ *   there is a window per monitor, each shows every URL whose index modulo
+ *   the number of monitors is its monitor.
+ */
+static gboolean
+in_partition (EEMainWindow *mainwin, gint index)
+{
+    return mainwin->n_monitors < 2 || index % mainwin->n_monitors == MAX (mainwin->monitor, 0);
+}
+
+/*
+ * is_loadable: returns TRUE if the URL at index belongs to mainwin and
+ *   parses, so load_url can show it.  the entry is parsed if it hasn't
+ *   been yet, and one which doesn't parse stays marked as invalid.
+ */
+static gboolean
+is_loadable (EEMainWindow *mainwin, gint index)
+{
+    return in_partition (mainwin, index)
+        && ee_playlist_get_parsed (mainwin->settings->urls, index) != NULL;
+}
+
+/*
+ * next_url: returns the index of the next URL to cycle to after index,
+ *   passing over URLs which are skipped, invalid or belong to another
+ *   window.  if every valid URL is skipped, then the next one is returned
+ *   anyway.
+ */
+static gint
+next_url (EEMainWindow *mainwin, gint index)
+{
+    guint n = ee_playlist_length (mainwin->settings->urls);
+    gint first = -1, next = index;
+
+    while (n-- > 0) {
+        next = ee_playlist_next (mainwin->settings->urls, next);
+        if (!is_loadable (mainwin, next))
+            continue;
+        if (first < 0)
+            first = next;
+        if (!is_skipped (mainwin, next))
+            return next;
+    }
+    return first;
+}
+
+/*
+ * get_load_timeout: returns how many seconds the URL at index may take to
+ *   load.
+ */
+static guint
+get_load_timeout (EEMainWindow *mainwin, gint index)
+{
+    EEUrl *url = ee_playlist_get (mainwin->settings->urls, index);
+
+    if (url && url->timeout > 0)
+        return url->timeout;
+    return (guint) MAX (mainwin->settings->load_timeout, 1);
+}
+
+/*
+ * on_refresh: reload a view whose URL has a refresh interval.  the next
+ *   refresh is scheduled when the reload finishes.
+ */
+static void
+on_refresh (EEPoolView *view)
+{
+    view->refresh_id = 0;
+    if (view->url == NULL)
+        return;
+    g_debug ("refreshing URL: %s", view->url);
+    view->finished = FALSE;
+    webkit_web_view_reload (view->webview);
+}
+
+/*
+ * schedule_refresh: if the URL in view has a refresh interval, then reload
+ *   it that many seconds from now, whether or not it is visible.
+ */
+static void
+schedule_refresh (EEMainWindow *mainwin, EEPoolView *view)
+{
+    EEUrl *url;
+
+    if (view->refresh_id > 0) {
+        ee_scheduler_remove (mainwin->scheduler, view->refresh_id);
+        view->refresh_id = 0;
+    }
+    if (view->url == NULL)
+        return;
+    url = ee_playlist_get (mainwin->settings->urls,
+        ee_playlist_find (mainwin->settings->urls, view->url, -1));
+    if (url == NULL || url->refresh == 0)
+        return;
+    view->refresh_id = ee_scheduler_add (mainwin->scheduler, url->refresh * 1000,
+        (EESchedulerFunc) on_refresh, view);
+}
+
+/*
+ * swap_views: make the preload view visible.
+ */
+static void
+swap_views (EEMainWindow *mainwin)
+{
+    EEPoolView *preload = mainwin->preload;
+
+    mainwin->curr_url = mainwin->preload_url;
+    mainwin->preload_url = -1;
+    mainwin->preload = NULL;
+    mainwin->swap_pending = FALSE;
+    show_view (mainwin, preload);
+    g_debug ("switched to preloaded view");
+}
+
+/*
+ * expire_timeout: run on_timeout now rather than when it is due.  this is
+ *   done from the main loop rather than directly, since it starts loading
+ *   another URL and we may be inside a webview signal handler.
+ */
+static void
+expire_timeout (EEMainWindow *mainwin)
+{
+    if (mainwin->timeout_id == 0)
+        return;
+    ee_scheduler_remove (mainwin->scheduler, mainwin->timeout_id);
+    mainwin->timeout_id = ee_scheduler_add (mainwin->scheduler, 0,
+        (EESchedulerFunc) on_timeout, mainwin);
+}
+
+/*
+ * on_load_finished: callback when we've finished loading a URL.  this is
+ *   also emitted after a failed load, which on_load_error has already
+ *   dealt with.
  */
 static void
 on_load_finished (WebKitWebView *       webview,
                   WebKitWebFrame *      frame,
                   EEMainWindow *        mainwin)
 {
+    EEPoolView *view = ee_view_pool_get_view (webview);
+    gchar *stats, *cache_stats, *tooltip;
+
+    EE_TRACE_INSTANT ("load", "load-finished", webkit_web_view_get_uri (webview));
+    schedule_refresh (mainwin, view);
+    /* load-finished is also emitted when a load is stopped or cancelled,
+     * which only counts as a success if the page really finished */
+    if (view && !view->failed && webkit_web_view_get_load_status (webview) == WEBKIT_LOAD_FINISHED)
+        record_load (mainwin, view->url, TRUE);
+    if (webview != mainwin->webview) {
+        if (mainwin->preload == NULL || webview != mainwin->preload->webview)
+            return;
+        g_debug ("finished preloading next URL");
+        /* if the cycle already expired, then switch now, and give the
+         * newly visible page a full cycle before moving on.  a preload
+         * which failed or whose entry was removed is skipped instead */
+        if (mainwin->swap_pending && (view->failed || mainwin->preload_url < 0))
+            expire_timeout (mainwin);
+        else if (mainwin->swap_pending) {
+            swap_views (mainwin);
+            if (mainwin->timeout_id > 0) {
+                ee_scheduler_remove (mainwin->scheduler, mainwin->timeout_id);
+                start_cycle (mainwin);
+            }
+        }
+        return;
+    }
+    /* the dwell time starts once the page has loaded */
+    if (mainwin->loading && mainwin->timeout_id > 0 && !view->failed) {
+        ee_scheduler_remove (mainwin->scheduler, mainwin->timeout_id);
+        start_cycle (mainwin);
+    }
     gtk_label_set_text (mainwin->status, "");
+    /* hovering over the status shows how well the HTTP cache and the
+     * credentials cache are doing */
+    stats = ee_auth_cache_get_stats (mainwin->auth);
+    if (mainwin->settings->cache) {
+        cache_stats = ee_cache_get_stats (mainwin->settings->cache);
+        tooltip = g_strdup_printf ("%s\n%s", cache_stats, stats);
+        g_debug ("%s", cache_stats);
+        g_free (cache_stats);
+    }
+    else
+        tooltip = g_strdup (stats);
+    g_debug ("%s", stats);
+    gtk_widget_set_tooltip_text (GTK_WIDGET (mainwin->status), tooltip);
+    g_free (tooltip);
+    g_free (stats);
+}
+
+/*
+ * on_load_error: callback when a URL fails to load.  if the visible URL
+ *   fails while we are waiting for it, then move on to the next URL
+ *   straight away, unless every other URL is failing too, in which case
+ *   the error page is left up until the load times out.
+ */
+static gboolean
+on_load_error (WebKitWebView *         webview,
+               WebKitWebFrame *        frame,
+               gchar *                 uri,
+               GError *                error,
+               EEMainWindow *          mainwin)
+{
+    EEPoolView *view = ee_view_pool_get_view (webview);
+
+    if (view == NULL || frame != webkit_web_view_get_main_frame (webview))
+        return FALSE;
+    /* loads are cancelled whenever a view is reused or stopped */
+    if (error->domain == WEBKIT_NETWORK_ERROR && error->code == WEBKIT_NETWORK_ERROR_CANCELLED)
+        return FALSE;
+    g_debug ("failed to load %s: %s", uri, error->message);
+    EE_TRACE_INSTANT ("load", "load-error", uri);
+    view->failed = TRUE;
+    if (webview == mainwin->webview && mainwin->loading) {
+        if (!is_skipped (mainwin, next_url (mainwin, mainwin->curr_url)))
+            expire_timeout (mainwin);
+    }
+    /* a failed load is recorded here, timeouts are recorded by on_timeout */
+    else
+        record_load (mainwin, view->url, FALSE);
+    return FALSE;
+}
+
+/*
+ * get_profile_settings: returns the web settings for pages of profile,
+ *   which are a copy of the shared settings with the profile applied on
+ *   top, or the shared settings if profile is NULL.  copies are made on
+ *   first use and kept until the window is destroyed.
+ */
+static WebKitWebSettings *
+get_profile_settings (EEMainWindow *mainwin, EEProfile *profile)
+{
+    WebKitWebSettings *websettings;
+
+    if (profile == NULL)
+        return mainwin->pool->websettings;
+    websettings = g_hash_table_lookup (mainwin->profile_settings, profile);
+    if (websettings == NULL) {
+        websettings = webkit_web_settings_copy (mainwin->pool->websettings);
+        ee_profile_apply (profile, websettings);
+        g_hash_table_insert (mainwin->profile_settings, profile, websettings);
+    }
+    return websettings;
+}
+
+/*
+ * apply_profile: set up webview to load url with the URL's render profile.
+ *   this has to happen before the load starts for the settings to apply
+ *   to the new page.
+ */
+static void
+apply_profile (EEMainWindow *mainwin, WebKitWebView *webview, EEUrl *url)
+{
+    EEProfile *profile = ee_settings_get_profile (mainwin->settings, url);
+    WebKitWebSettings *websettings = get_profile_settings (mainwin, profile);
+
+    if (webkit_web_view_get_settings (webview) != websettings)
+        webkit_web_view_set_settings (webview, websettings);
+    webkit_web_view_set_zoom_level (webview, profile && profile->zoom > 0.0 ? profile->zoom : 1.0);
+    g_object_set_data (G_OBJECT (webview), EE_MAIN_WINDOW_PROFILE, profile);
+}
+
+/*
+ * on_resource_request_starting: callback for every resource a webview is
+ *   about to request, where requests are tied to the page load they are
+ *   made for.
+ *   resources matching the block patterns of the page's profile are
+ *   redirected to about:blank, which never touches the network.
+ */
+static void
+on_resource_request_starting (WebKitWebView *       webview,
+                              WebKitWebFrame *      frame,
+                              WebKitWebResource *   resource,
+                              WebKitNetworkRequest *request,
+                              WebKitNetworkResponse *response,
+                              EEMainWindow *        mainwin)
+{
+    SoupMessage *message;
+    EEProfile *profile;
+    const gchar *uri;
+    gboolean document;
+
+    /* the page itself, including redirects, is never blocked */
+    document = frame == webkit_web_view_get_main_frame (webview)
+        && webkit_web_frame_get_load_status (frame) == WEBKIT_LOAD_PROVISIONAL;
+    /* the offscreen snapshot webview isn't loaded by load_url, so its
+     * profile is applied when the page is requested */
+    if (document && mainwin->snapshots && webview == mainwin->snapshots->webview
+        && ee_snapshots_get_current (mainwin->snapshots))
+        apply_profile (mainwin, webview, ee_snapshots_get_current (mainwin->snapshots));
+    profile = g_object_get_data (G_OBJECT (webview), EE_MAIN_WINDOW_PROFILE);
+    if (!document && profile) {
+        uri = webkit_network_request_get_uri (request);
+        if (ee_profile_blocks (profile, uri)) {
+            g_debug ("blocking resource %s (profile %s)", uri, profile->name);
+            webkit_network_request_set_uri (request, "about:blank");
+            return;
+        }
+    }
+
+    message = webkit_network_request_get_message (request);
+    if (message == NULL)
+        return;
+    if (mainwin->settings->loads)
+        ee_load_log_tag (mainwin->settings->loads, webview, message, document);
+    if (mainwin->settings->cache)
+        ee_cache_tag_request (mainwin->settings->cache, message);
 }
 
 /*
@@ -101,45 +594,145 @@ on_title_changed (WebKitWebView *       webview,
 {
     gchar *window_title;
 
+    if (webview != mainwin->webview)
+        return;
     window_title = g_strdup_printf ("Eagle Eye - %s", title);
     gtk_window_set_title (mainwin->window, window_title);
     g_free (window_title);
 }
 
 /*
- * load_url: loads mainwin->curr_url into the webview widget
+ * show_snapshot: show the snapshot image in place of the webviews, or hide
+ *   it again if pixbuf is NULL.
+ */
+static void
+show_snapshot (EEMainWindow *mainwin, EEUrl *url, GdkPixbuf *pixbuf)
+{
+    GtkWidget *notebook = ee_view_pool_get_widget (mainwin->pool);
+    gchar *window_title;
+
+    mainwin->showing_snapshot = pixbuf != NULL;
+    if (pixbuf == NULL) {
+        gtk_widget_hide (mainwin->snapshot_box);
+        gtk_widget_show (notebook);
+        return;
+    }
+    gtk_image_set_from_pixbuf (mainwin->snapshot_image, pixbuf);
+    gtk_widget_hide (notebook);
+    gtk_widget_show (mainwin->snapshot_box);
+    window_title = g_strdup_printf ("Eagle Eye - %s", url->display);
+    gtk_window_set_title (mainwin->window, window_title);
+    g_free (window_title);
+    gtk_label_set_text (mainwin->status, "");
+}
+
+/*
+ * load_url: shows mainwin->curr_url.  in snapshot mode the most recent
+ *   snapshot of the URL is shown if there is one.  otherwise if the URL is
+ *   retained in a hidden view then that view is made visible, otherwise
+ *   the URL is loaded into the visible view.
  */
 static gboolean
 load_url (EEMainWindow *mainwin)
 {
-    gchar *s;
+    EEUrl *url;
+    EEPoolView *view;
+    GdkPixbuf *pixbuf;
+    const gchar *s;
 
-    if (mainwin->curr_url == NULL)
+    url = ee_playlist_get_parsed (mainwin->settings->urls, mainwin->curr_url);
+    if (url == NULL)
         return FALSE;
-    s = soup_uri_to_string ((SoupURI *)mainwin->curr_url->data, FALSE);
-    g_debug ("opening URL: %s", s);
-    webkit_web_view_load_uri (mainwin->webview, s);
-    g_free (s);
+    s = url->display;
+    EE_TRACE_BEGIN ("cycle", "load_url", s);
+    ee_auth_cache_add_url (mainwin->auth, url);
+    if (mainwin->snapshots) {
+        pixbuf = mainwin->interactive ? NULL : ee_snapshots_lookup (mainwin->snapshots, s);
+        show_snapshot (mainwin, url, pixbuf);
+        if (pixbuf) {
+            g_debug ("showing snapshot of URL: %s", s);
+            EE_TRACE_END ("cycle", "load_url");
+            return TRUE;
+        }
+    }
+    view = ee_view_pool_lookup (mainwin->pool, s);
+    if (view && view != mainwin->visible) {
+        g_debug ("showing retained URL: %s", s);
+        show_view (mainwin, view);
+        if (mainwin->settings->refresh_on_show || !view->finished || view->failed) {
+            view->finished = FALSE;
+            apply_profile (mainwin, view->webview, url);
+            webkit_web_view_reload (view->webview);
+        }
+    }
+    else {
+        g_debug ("opening URL: %s", s);
+        apply_profile (mainwin, mainwin->visible->webview, url);
+        ee_view_pool_load (mainwin->pool, mainwin->visible, s);
+    }
+    EE_TRACE_END ("cycle", "load_url");
     return TRUE;
 }
 
+/*
+ * cancel_preload: abandon the page loading in the preload view, if any
+ */
+static void
+cancel_preload (EEMainWindow *mainwin)
+{
+    EEPoolView *preload = mainwin->preload;
+
+    if (mainwin->preload_id > 0) {
+        ee_scheduler_remove (mainwin->scheduler, mainwin->preload_id);
+        mainwin->preload_id = 0;
+    }
+    mainwin->preload_url = -1;
+    mainwin->preload = NULL;
+    mainwin->swap_pending = FALSE;
+    if (preload == NULL)
+        return;
+    /* a partially loaded page is useless, so don't retain it */
+    if (!preload->finished) {
+        ee_view_pool_stop (preload, FALSE);
+        g_free (preload->url);
+        preload->url = NULL;
+    }
+}
+
+/*
+ * get_preload: returns the preload view, or NULL if there is none.  if
+ *   the entry it was loaded for has been removed from the playlist, then
+ *   the preload is cancelled rather than shown in place of another entry.
+ */
+static EEPoolView *
+get_preload (EEMainWindow *mainwin)
+{
+    if (mainwin->preload && mainwin->preload_url < 0) {
+        g_debug ("preloaded URL was removed, abandoning it");
+        cancel_preload (mainwin);
+    }
+    return mainwin->preload;
+}
+
 /*
  * open_previous_url: jump to the previous URL and load it
  */
 static void
 open_previous_url (EEMainWindow *mainwin)
 {
-    GList *prev;
+    guint n = ee_playlist_length (mainwin->settings->urls);
+    gint prev = mainwin->curr_url;
 
-    /* get the next URL in the list */
-    prev = g_list_previous (mainwin->curr_url);
-    /* if NULL, then try to wrap around to the last URL in the list */
-    if (prev == NULL)
-        prev = g_list_last (mainwin->settings->urls);
-    /* if still NULL, then there are no URLS in the list, so return */
-    if (prev == NULL)
+    /* get the previous valid URL of this window in the list, wrapping
+     * around to the last URL */
+    do {
+        prev = ee_playlist_previous (mainwin->settings->urls, prev);
+    } while (prev >= 0 && !is_loadable (mainwin, prev) && --n > 0);
+    /* if -1, then there are no URLS for this window, so return */
+    if (prev < 0 || !is_loadable (mainwin, prev))
         return;
     mainwin->curr_url = prev;
+    mainwin->interactive = FALSE;
     load_url (mainwin);
 }
 
@@ -149,30 +742,343 @@ open_previous_url (EEMainWindow *mainwin)
 static void
 open_next_url (EEMainWindow *mainwin)
 {
-    GList *next;
+    gint next;
 
-    /* get the next URL in the list */
-    next = g_list_next (mainwin->curr_url);
-    /* if NULL, then try to wrap around to the first URL in the list */
-    if (next == NULL)
-        next = g_list_first (mainwin->settings->urls);
-    /* if still NULL, then there are no URLS in the list, so return */
-    if (next == NULL)
+    /* get the next URL in the list, wrapping around to the first URL and
+     * passing over URLs which have been failing */
+    next = next_url (mainwin, mainwin->curr_url);
+    /* if -1, then there are no URLS in the list, so return */
+    if (next < 0)
         return;
     mainwin->curr_url = next;
+    mainwin->interactive = FALSE;
     load_url (mainwin);
 }
 
 /*
- * on_timeout: loads the next URL every time the cycle-time timeout expires
+ * get_dwell: returns how many seconds the URL at index is shown for.
  */
-static gboolean
+static guint
+get_dwell (EEMainWindow *mainwin, gint index)
+{
+    EEUrl *url = ee_playlist_get (mainwin->settings->urls, index);
+
+    if (url && url->dwell > 0)
+        return url->dwell;
+    return (guint) MAX (mainwin->settings->cycle_time, 1);
+}
+
+/*
+ * get_aligned_slot: returns the index of the URL whose slot contains the
+ *   wall clock time at, in milliseconds since the epoch.  the slots of
+ *   mainwin's URLs follow each other in playlist order, each as long as
+ *   the URL's dwell time, repeating from the epoch onwards.  so kiosks
+ *   with the same playlist and synchronized clocks agree on which URL is
+ *   due without talking to each other.  if end isn't NULL, then it is set
+ *   to the time the slot ends.  returns -1 if there are no URLs.
+ */
+static gint
+get_aligned_slot (EEMainWindow *mainwin, gint64 at, gint64 *end)
+{
+    guint n = ee_playlist_length (mainwin->settings->urls);
+    gint64 period = 0, offset;
+    guint i;
+
+    for (i = 0; i < n; i++)
+        if (in_partition (mainwin, i))
+            period += get_dwell (mainwin, i) * 1000;
+    if (period == 0)
+        return -1;
+    /* walk the slots until the one which ends after at */
+    offset = at % period;
+    for (i = 0; i < n; i++) {
+        if (!in_partition (mainwin, i))
+            continue;
+        offset -= get_dwell (mainwin, i) * 1000;
+        if (offset < 0)
+            break;
+    }
+    if (end)
+        *end = at - offset;
+    return (gint) i;
+}
+
+/*
+ * get_next_url: returns the index of the URL which will be cycled to
+ *   next, which is the URL of the next slot if the cycle is aligned to the
+ *   clock.
+ */
+static gint
+get_next_url (EEMainWindow *mainwin)
+{
+    if (mainwin->settings->aligned_cycle)
+        return get_aligned_slot (mainwin, mainwin->slot_end, NULL);
+    return next_url (mainwin, mainwin->curr_url);
+}
+
+/*
+ * on_preload: start loading the next URL into a hidden view.  if the URL
+ *   is already retained in a hidden view then it is refreshed in place
+ *   (or used as-is if refresh-on-show is disabled).
+ */
+static void
+on_preload (EEMainWindow *mainwin)
+{
+    EEUrl *url;
+    gint next;
+    EEPoolView *view;
+    const gchar *s;
+
+    mainwin->preload_id = 0;
+    next = get_next_url (mainwin);
+    /* don't bother preloading if there is nothing else to cycle to */
+    if (next < 0 || next == mainwin->curr_url)
+        return;
+    url = ee_playlist_get_parsed (mainwin->settings->urls, next);
+    if (url == NULL)
+        return;
+    s = url->display;
+    ee_auth_cache_add_url (mainwin->auth, url);
+    view = ee_view_pool_lookup (mainwin->pool, s);
+    if (view && view != mainwin->visible) {
+        if (mainwin->settings->refresh_on_show || !view->finished || view->failed) {
+            g_debug ("refreshing retained URL: %s", s);
+            view->finished = FALSE;
+            apply_profile (mainwin, view->webview, url);
+            webkit_web_view_reload (view->webview);
+        }
+    }
+    else {
+        /* if the pool only has room for the visible view, then give up */
+        view = ee_view_pool_acquire (mainwin->pool);
+        if (view == NULL)
+            return;
+        g_debug ("preloading URL: %s", s);
+        apply_profile (mainwin, view->webview, url);
+        ee_view_pool_load (mainwin->pool, view, s);
+    }
+    mainwin->preload = view;
+    mainwin->preload_url = next;
+    mainwin->swap_pending = FALSE;
+}
+
+/*
+ * on_warmup: resolve the host of the next URL ahead of time, so that
+ *   switching to it doesn't wait for DNS.  libsoup has no way to open a
+ *   connection for the session to reuse without sending a request on it,
+ *   and nothing is sent, so TCP and TLS setup still happen on the switch
+ *   unless the preload has already done them.
+ */
+static void
+on_warmup (EEMainWindow *mainwin)
+{
+    EEUrl *url;
+    gint next;
+
+    mainwin->warmup_id = 0;
+    next = get_next_url (mainwin);
+    if (next < 0 || next == mainwin->curr_url)
+        return;
+    url = ee_playlist_get_parsed (mainwin->settings->urls, next);
+    if (url == NULL || url->host == NULL)
+        return;
+    g_debug ("resolving %s ahead of time", url->host);
+    soup_session_prefetch_dns (mainwin->session, url->host, NULL, NULL, NULL);
+}
+
+/*
+ * schedule_warmup: arrange for the host of the next URL to be resolved
+ *   warmup-time seconds before the current URL's dwell time expires.  with
+ *   the default settings this happens before the preload, so the preload
+ *   finds the address already cached.
+ */
+static void
+schedule_warmup (EEMainWindow *mainwin, guint dwell)
+{
+    gint warmup_time = mainwin->settings->warmup_time;
+
+    if (mainwin->warmup_id > 0) {
+        ee_scheduler_remove (mainwin->scheduler, mainwin->warmup_id);
+        mainwin->warmup_id = 0;
+    }
+    if (warmup_time <= 0 || mainwin->snapshots)
+        return;
+    mainwin->warmup_id = ee_scheduler_add (mainwin->scheduler,
+        dwell > (guint) warmup_time ? (dwell - warmup_time) * 1000 : 0,
+        (EESchedulerFunc) on_warmup, mainwin);
+}
+
+/*
+ * schedule_preload: arrange for the next URL to start loading preload-time
+ *   seconds before the current URL's dwell time expires.
+ */
+static void
+schedule_preload (EEMainWindow *mainwin)
+{
+    guint dwell = get_dwell (mainwin, mainwin->curr_url);
+    gint preload_time = mainwin->settings->preload_time;
+
+    /* snapshots are rendered in the background anyway */
+    if (preload_time <= 0 || mainwin->snapshots)
+        return;
+    mainwin->preload_id = ee_scheduler_add (mainwin->scheduler,
+        dwell > (guint) preload_time ? (dwell - preload_time) * 1000 : 0,
+        (EESchedulerFunc) on_preload, mainwin);
+}
+
+/*
+ * on_timeout: loads the next URL when the current URL's dwell time expires,
+ *   or when the URL being waited for doesn't load in time
+ */
+static void
 on_timeout (EEMainWindow *mainwin)
 {
-    g_debug ("cycling to next URL");
-    open_next_url (mainwin);
-    g_debug ("next cycle is scheduled in %i seconds", mainwin->settings->cycle_time);
-    return TRUE;
+    EEPoolView *preload = get_preload (mainwin);
+
+    EE_TRACE_BEGIN ("cycle", "on_timeout", NULL);
+    mainwin->timeout_id = 0;
+    if (mainwin->loading) {
+        /* the visible URL failed or didn't load in time, so skip it */
+        g_debug ("giving up on URL");
+        mainwin->loading = FALSE;
+        ee_view_pool_stop (mainwin->visible, TRUE);
+        record_load (mainwin, mainwin->visible->url, FALSE);
+        open_next_url (mainwin);
+    }
+    else if (preload && preload->finished && !preload->failed) {
+        g_debug ("cycling to next URL");
+        swap_views (mainwin);
+    }
+    else if (preload && !preload->failed && !mainwin->swap_pending) {
+        /* wait for load-finished rather than showing a half-rendered page */
+        g_debug ("preloaded URL is still loading, deferring switch");
+        mainwin->swap_pending = TRUE;
+        mainwin->timeout_id = ee_scheduler_add (mainwin->scheduler,
+            get_load_timeout (mainwin, mainwin->preload_url) * 1000,
+            (EESchedulerFunc) on_timeout, mainwin);
+        EE_TRACE_END ("cycle", "on_timeout");
+        return;
+    }
+    else {
+        /* the preload failed or didn't finish in time, so skip it */
+        if (preload) {
+            g_debug ("giving up on preloaded URL");
+            if (!preload->failed) {
+                record_load (mainwin, preload->url, FALSE);
+                if (!preload->finished)
+                    ee_view_pool_stop (preload, TRUE);
+            }
+            mainwin->curr_url = mainwin->preload_url;
+            cancel_preload (mainwin);
+        }
+        g_debug ("cycling to next URL");
+        open_next_url (mainwin);
+    }
+    start_cycle (mainwin);
+    EE_TRACE_END ("cycle", "on_timeout");
+}
+
+static void on_aligned_timeout (EEMainWindow *mainwin);
+
+/*
+ * start_aligned_cycle: schedule the switch to the next URL at the end of
+ *   the current slot, and the preload and warm-up ahead of it.  the delay
+ *   is worked out from the wall clock each cycle rather than added up, so
+ *   it doesn't drift, and clock corrections are picked up by the next
+ *   cycle.
+ */
+static void
+start_aligned_cycle (EEMainWindow *mainwin)
+{
+    gint preload_time = mainwin->settings->preload_time;
+    gint64 now = g_get_real_time () / 1000;
+    gint64 delay;
+
+    /* the slot ends when it ends, however long the page takes to load */
+    mainwin->loading = FALSE;
+    if (get_aligned_slot (mainwin, now, &mainwin->slot_end) < 0)
+        return;
+    delay = mainwin->slot_end - now;
+    mainwin->timeout_id = ee_scheduler_add (mainwin->scheduler, (guint) delay,
+        (EESchedulerFunc) on_aligned_timeout, mainwin);
+    if (mainwin->preload_id == 0 && preload_time > 0 && !mainwin->snapshots)
+        mainwin->preload_id = ee_scheduler_add (mainwin->scheduler,
+            (guint) MAX (delay - preload_time * 1000, 0), (EESchedulerFunc) on_preload, mainwin);
+    schedule_warmup (mainwin, (guint) (delay / 1000));
+    g_debug ("next aligned cycle is scheduled in %" G_GINT64_FORMAT " ms", delay);
+}
+
+/*
+ * on_aligned_timeout: switch to the URL whose slot starts now.  a preload
+ *   which hasn't finished is shown anyway, since switching in step with
+ *   the other kiosks matters more than hiding a half-rendered page.  URLs
+ *   which have been failing aren't passed over, as the other kiosks don't
+ *   know about the failures.
+ */
+static void
+on_aligned_timeout (EEMainWindow *mainwin)
+{
+    EEPoolView *preload = get_preload (mainwin);
+    gint64 jitter = g_get_real_time () / 1000 - mainwin->slot_end;
+    gint slot;
+
+    mainwin->timeout_id = 0;
+    if (ABS (jitter) > EE_MAIN_WINDOW_JITTER_MAX)
+        g_warning ("aligned cycle switched %" G_GINT64_FORMAT " ms from the slot boundary", jitter);
+    else
+        g_debug ("aligned cycle switched %" G_GINT64_FORMAT " ms from the slot boundary", jitter);
+    if (metrics)
+        ee_metrics_record_jitter (jitter, metrics);
+
+    /* the timer may fire a little early, so switch to the slot which is
+     * starting rather than the one the clock is still in */
+    slot = get_aligned_slot (mainwin, mainwin->slot_end + MAX (jitter, 0), NULL);
+    if (slot >= 0 && slot != mainwin->curr_url) {
+        if (preload && mainwin->preload_url == slot && !preload->failed) {
+            g_debug ("cycling to preloaded URL");
+            swap_views (mainwin);
+        }
+        else {
+            cancel_preload (mainwin);
+            mainwin->curr_url = slot;
+            mainwin->interactive = FALSE;
+            load_url (mainwin);
+        }
+    }
+    start_aligned_cycle (mainwin);
+}
+
+/*
+ * start_cycle: schedule the switch to the next URL once the current URL's
+ *   dwell time expires, and the preload ahead of it.  if the current URL is
+ *   still loading, then the dwell time doesn't start until it has loaded,
+ *   and the URL is given up on if it doesn't load in time.
+ */
+static void
+start_cycle (EEMainWindow *mainwin)
+{
+    guint dwell = get_dwell (mainwin, mainwin->curr_url);
+    guint timeout;
+
+    if (mainwin->settings->aligned_cycle) {
+        start_aligned_cycle (mainwin);
+        return;
+    }
+    mainwin->loading = !mainwin->showing_snapshot && !mainwin->visible->finished;
+    if (mainwin->loading) {
+        timeout = get_load_timeout (mainwin, mainwin->curr_url);
+        mainwin->timeout_id = ee_scheduler_add (mainwin->scheduler, timeout * 1000,
+            (EESchedulerFunc) on_timeout, mainwin);
+        g_debug ("waiting up to %u seconds for URL to load", timeout);
+        return;
+    }
+
+    mainwin->timeout_id = ee_scheduler_add (mainwin->scheduler, dwell * 1000,
+        (EESchedulerFunc) on_timeout, mainwin);
+    if (mainwin->preload_id == 0 && !mainwin->swap_pending)
+        schedule_preload (mainwin);
+    schedule_warmup (mainwin, dwell);
+    g_debug ("next cycle is scheduled in %u seconds", dwell);
 }
 
 /*
@@ -185,17 +1091,19 @@ on_clicked_back (GtkToolButton *        button,
     guint timeout_id = mainwin->timeout_id;
 
     g_debug ("---- BACK ----");
+    if (mainwin->grid) {
+        ee_tile_grid_step (mainwin->grid, FALSE);
+        return;
+    }
     if (timeout_id > 0) {
-        g_source_remove (timeout_id);
+        ee_scheduler_remove (mainwin->scheduler, timeout_id);
         mainwin->timeout_id = 0;
     }
+    cancel_preload (mainwin);
     open_previous_url (mainwin);
     /* if we are not paused, then reschedule the cycle timeout */
-    if (timeout_id > 0) {
-        mainwin->timeout_id = g_timeout_add_seconds (mainwin->settings->cycle_time,
-            (GSourceFunc) on_timeout, mainwin);
-        g_debug ("next cycle is scheduled in %i seconds", mainwin->settings->cycle_time);
-    }
+    if (timeout_id > 0)
+        start_cycle (mainwin);
 }
 
 /*
@@ -208,17 +1116,29 @@ on_clicked_forward (GtkToolButton *     button,
     guint timeout_id = mainwin->timeout_id;
 
     g_debug ("---- FORWARD ----");
+    if (mainwin->grid) {
+        ee_tile_grid_step (mainwin->grid, TRUE);
+        return;
+    }
     if (timeout_id > 0) {
-        g_source_remove (timeout_id);
+        ee_scheduler_remove (mainwin->scheduler, timeout_id);
         mainwin->timeout_id = 0;
     }
-    open_next_url (mainwin);
-    /* if we are not paused, then reschedule the cycle timeout */
-    if (timeout_id > 0) {
-        mainwin->timeout_id = g_timeout_add_seconds (mainwin->settings->cycle_time,
-            (GSourceFunc) on_timeout, mainwin);
-        g_debug ("next cycle is scheduled in %i seconds", mainwin->settings->cycle_time);
+    /* if the next URL is already preloaded, then just show it */
+    if (get_preload (mainwin) && mainwin->preload->finished && !mainwin->preload->failed) {
+        if (mainwin->preload_id > 0) {
+            ee_scheduler_remove (mainwin->scheduler, mainwin->preload_id);
+            mainwin->preload_id = 0;
+        }
+        swap_views (mainwin);
     }
+    else {
+        cancel_preload (mainwin);
+        open_next_url (mainwin);
+    }
+    /* if we are not paused, then reschedule the cycle timeout */
+    if (timeout_id > 0)
+        start_cycle (mainwin);
 }
 
 /*
@@ -229,16 +1149,25 @@ static void
 on_toggled_pause (GtkToggleToolButton *         button,
                   EEMainWindow *                mainwin)
 {
+    if (mainwin->grid) {
+        ee_tile_grid_set_paused (mainwin->grid, gtk_toggle_tool_button_get_active (button));
+        g_debug (mainwin->grid->paused ? "---- PAUSE ----" : "---- UNPAUSE ----");
+        return;
+    }
     if (gtk_toggle_tool_button_get_active (button)) {
-        g_source_remove (mainwin->timeout_id);
+        ee_scheduler_remove (mainwin->scheduler, mainwin->timeout_id);
         mainwin->timeout_id = 0;
+        mainwin->loading = FALSE;
+        if (mainwin->warmup_id > 0) {
+            ee_scheduler_remove (mainwin->scheduler, mainwin->warmup_id);
+            mainwin->warmup_id = 0;
+        }
+        cancel_preload (mainwin);
         g_debug ("---- PAUSE ----");
     }
     else {
-        mainwin->timeout_id = g_timeout_add_seconds (mainwin->settings->cycle_time,
-            (GSourceFunc) on_timeout, mainwin);
         g_debug ("---- UNPAUSE ----");
-        g_debug ("next cycle is scheduled in %i seconds", mainwin->settings->cycle_time);
+        start_cycle (mainwin);
     }
 }
 
@@ -271,7 +1200,9 @@ on_clicked_edit (GtkToolButton *        button,
 
     g_debug ("---- EDIT ----");
     dialog = ee_url_manager_new (mainwin->settings);
+    EE_TRACE_BEGIN ("dialog", "url-manager", NULL);
     gtk_dialog_run (GTK_DIALOG (dialog));
+    EE_TRACE_END ("dialog", "url-manager");
     gtk_widget_destroy (dialog);
 }
 
@@ -313,17 +1244,186 @@ on_populate_popup (WebKitWebView *      webview,
 }
 
 /*
- * ee_main_window_construct: create the main window
+ * on_webview_destroy: cancel any pending refresh when the pool destroys a
+ *   view.  views which are freed along with the pool are already detached
+ *   from their webviews by then.
+ */
+static void
+on_webview_destroy (WebKitWebView *     webview,
+                    EEMainWindow *      mainwin)
+{
+    EEPoolView *view = ee_view_pool_get_view (webview);
+
+    if (view == NULL || view->refresh_id == 0)
+        return;
+    ee_scheduler_remove (mainwin->scheduler, view->refresh_id);
+    view->refresh_id = 0;
+}
+
+/*
+ * setup_webview: connect signal handlers to a webview created by the pool
+ */
+static void
+setup_webview (WebKitWebView *webview, EEMainWindow *mainwin)
+{
+    g_signal_connect(webview, "load-started",
+        G_CALLBACK (on_load_started), mainwin);
+    g_signal_connect(webview, "load-finished",
+        G_CALLBACK (on_load_finished), mainwin);
+    g_signal_connect(webview, "load-error",
+        G_CALLBACK (on_load_error), mainwin);
+    g_signal_connect(webview, "title-changed",
+        G_CALLBACK (on_title_changed), mainwin);
+    g_signal_connect(webview, "populate-popup",
+        G_CALLBACK (on_populate_popup), mainwin);
+    g_signal_connect(webview, "resource-request-starting",
+        G_CALLBACK (on_resource_request_starting), mainwin);
+    g_signal_connect(webview, "destroy",
+        G_CALLBACK (on_webview_destroy), mainwin);
+    if (mainwin->settings->loads)
+        ee_load_log_watch (mainwin->settings->loads, webview);
+}
+
+/*
+ * on_snapshot_event: switch from the snapshot to the live page when the
+ *   user clicks or scrolls on it.  the live page stays up until the cycle
+ *   moves on.
+ */
+static gboolean
+on_snapshot_event (GtkWidget *          widget,
+                   GdkEvent *           ev,
+                   EEMainWindow *       mainwin)
+{
+    g_debug ("switching from snapshot to live view");
+    mainwin->interactive = TRUE;
+    load_url (mainwin);
+    return TRUE;
+}
+
+/*
+ * on_size_allocate: render snapshots at the size they are shown at
+ */
+static void
+on_size_allocate (GtkWidget *           widget,
+                  GtkAllocation *       allocation,
+                  EEMainWindow *        mainwin)
+{
+    ee_snapshots_set_size (mainwin->snapshots, allocation->width, allocation->height);
+}
+
+/*
+ * setup_snapshot_webview: connect signal handlers to the offscreen webview.
+ *   only cache accounting applies, the page is never visible.
+ */
+static void
+setup_snapshot_webview (WebKitWebView *webview, EEMainWindow *mainwin)
+{
+    g_signal_connect(webview, "resource-request-starting",
+        G_CALLBACK (on_resource_request_starting), mainwin);
+}
+
+/*
+ * setup_tile_webview: connect signal handlers to a webview in the tile
+ *   grid.  the grid runs its own cycle, so only cache accounting, blocking
+ *   and the popup menu apply.
+ */
+static void
+setup_tile_webview (WebKitWebView *webview, EEMainWindow *mainwin)
+{
+    g_signal_connect(webview, "populate-popup",
+        G_CALLBACK (on_populate_popup), mainwin);
+    g_signal_connect(webview, "resource-request-starting",
+        G_CALLBACK (on_resource_request_starting), mainwin);
+    if (mainwin->settings->loads)
+        ee_load_log_watch (mainwin->settings->loads, webview);
+}
+
+/*
+ * on_tile_load: called just before a pane of the tile grid loads url.
+ */
+static void
+on_tile_load (WebKitWebView *webview, EEUrl *url, EEMainWindow *mainwin)
+{
+    ee_auth_cache_add_url (mainwin->auth, url);
+    apply_profile (mainwin, webview, url);
+}
+
+/*
+ * ee_main_window_set_web_setting: change the boolean web setting property
+ *   for all webviews, in every window.  render profiles which set the same
+ *   property still override it.
+ */
+void
+ee_main_window_set_web_setting (EEMainWindow *mainwin, const gchar *property, gboolean value)
+{
+    GHashTableIter iter;
+    EEProfile *profile;
+    WebKitWebSettings *websettings;
+    GList *item;
+
+    for (item = windows; item; item = g_list_next (item)) {
+        mainwin = (EEMainWindow *) item->data;
+        g_object_set (mainwin->pool->websettings, property, value, NULL);
+        g_hash_table_iter_init (&iter, mainwin->profile_settings);
+        while (g_hash_table_iter_next (&iter, (gpointer *) &profile, (gpointer *) &websettings)) {
+            g_object_set (websettings, property, value, NULL);
+            ee_profile_apply (profile, websettings);
+        }
+    }
+}
+
+/*
+ * setup_session: configure the WebKit session, which every window shares,
+ *   and attach the cookie jar, HTTP cache and credentials cache to it.
+ */
+static void
+setup_session (EESettings *settings)
+{
+    SoupSession *session = webkit_get_default_session ();
+
+    g_signal_connect (session, "authenticate",
+        G_CALLBACK (on_http_auth), settings);
+    soup_session_remove_feature_by_type (session, WEBKIT_TYPE_SOUP_AUTH_DIALOG);
+    /* connection limits and keep-alive, 0 leaves the WebKit defaults */
+    if (settings->max_connections > 0)
+        g_object_set (session, SOUP_SESSION_MAX_CONNS, settings->max_connections, NULL);
+    if (settings->max_connections_per_host > 0)
+        g_object_set (session, SOUP_SESSION_MAX_CONNS_PER_HOST,
+            settings->max_connections_per_host, NULL);
+    if (settings->idle_timeout > 0)
+        g_object_set (session, SOUP_SESSION_IDLE_TIMEOUT, (guint) settings->idle_timeout, NULL);
+    if (settings->cookie_jar)
+        soup_session_add_feature (session, SOUP_SESSION_FEATURE (settings->cookie_jar));
+    if (settings->cache)
+        ee_cache_attach (settings->cache, session);
+    settings->auth = ee_auth_cache_new (settings->urls);
+    ee_auth_cache_attach (settings->auth, session);
+    if (settings->loads)
+        ee_load_log_attach (settings->loads, session);
+    if (settings->metrics_port > 0)
+        metrics = ee_metrics_new (settings, settings->metrics_port);
+    if (metrics)
+        ee_load_log_set_func (settings->loads,
+            (EELoadLogFunc) ee_metrics_record_load, metrics);
+    if (settings->watchdog_interval > 0)
+        watchdog = ee_watchdog_new (settings->watchdog_interval,
+            MAX (settings->stall_threshold, 0), settings->stall_backtrace);
+    if (watchdog && metrics)
+        metrics->main_loop = &watchdog->latency;
+}
+
+/*
+ * ee_main_window_construct: create a main window.  if monitor isn't -1,
+ *   then the window covers that monitor, and shows its partition of the
+ *   playlist split n_monitors ways.
  */
 GtkWindow *
-ee_main_window_construct(EESettings *settings)
+ee_main_window_construct(EESettings *settings, gint monitor, gint n_monitors)
 {
     EEMainWindow *mainwin;
     GtkWindow *window;
     GtkWidget *vbox;
-    GtkWidget *webview;
     WebKitWebSettings *websettings;
-    GtkWidget *sw;
     GtkWidget *toolbar;
     GtkToolItem *back;
     GtkToolItem *forward;
@@ -334,18 +1434,34 @@ ee_main_window_construct(EESettings *settings)
     GtkWidget *status;
     GtkWidget *align;
     GtkToolItem *status_item;
+    GdkRectangle geometry;
 
     mainwin = g_new0 (EEMainWindow, 1);
 
     /* set the mainwin data for the main window */
     mainwin->settings = settings;
+    mainwin->monitor = monitor;
+    mainwin->n_monitors = monitor >= 0 ? MAX (n_monitors, 1) : 1;
+    mainwin->scheduler = ee_scheduler_new ();
+    mainwin->failures = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_free);
+    mainwin->profile_settings = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+        NULL, g_object_unref);
     mainwin->timeout_id = 0;
-    mainwin->curr_url = settings->urls;
+    mainwin->preload_id = 0;
+    mainwin->curr_url = (guint) MAX (monitor, 0) < ee_playlist_length (settings->urls) ? MAX (monitor, 0) : -1;
+    mainwin->preload_url = -1;
+    ee_playlist_add_cursor (settings->urls, &mainwin->curr_url);
+    ee_playlist_add_entry_cursor (settings->urls, &mainwin->preload_url);
 
     /* create the toplevel window */ 
     window = (GtkWindow *) gtk_window_new (GTK_WINDOW_TOPLEVEL);
     gtk_window_set_title (window, "Eagle Eye");
     gtk_window_set_default_size (window, 800, 600);
+    if (monitor >= 0) {
+        gdk_screen_get_monitor_geometry (gtk_window_get_screen (window), monitor, &geometry);
+        gtk_window_move (window, geometry.x, geometry.y);
+        gtk_window_set_default_size (window, geometry.width, geometry.height);
+    }
     mainwin->window = window;
     g_signal_connect (window, "destroy",
         G_CALLBACK (on_window_destroy), mainwin);
@@ -356,40 +1472,70 @@ ee_main_window_construct(EESettings *settings)
     vbox = gtk_vbox_new (FALSE, 0);
     gtk_container_add(GTK_CONTAINER (window), vbox);
 
-    /* create the webview widget */
-    webview = webkit_web_view_new ();
-    webkit_web_view_set_full_content_zoom(WEBKIT_WEB_VIEW (webview), TRUE);
-    mainwin->webview = WEBKIT_WEB_VIEW (webview);
-    g_signal_connect(webview, "load-started",
-        G_CALLBACK (on_load_started), mainwin);
-    g_signal_connect(WEBKIT_WEB_VIEW (webview), "load-finished",
-        G_CALLBACK (on_load_finished), mainwin);
-    g_signal_connect(WEBKIT_WEB_VIEW (webview), "title-changed",
-        G_CALLBACK (on_title_changed), mainwin);
-    g_signal_connect(WEBKIT_WEB_VIEW (webview), "populate-popup",
-        G_CALLBACK (on_populate_popup), mainwin);
-
-    /* configure the web settings object */
-    websettings = webkit_web_view_get_settings (mainwin->webview);
+    /* configure the web settings object, which is shared by all webviews */
+    websettings = webkit_web_settings_new ();
     if (settings->disable_plugins)
         g_object_set (websettings, "enable-plugins", FALSE, NULL);
     if (settings->disable_scripts)
         g_object_set (websettings, "enable-scripts", FALSE, NULL);
+
+    /* create the pool of webviews and put it in the vbox */
+    mainwin->pool = ee_view_pool_new (MAX (settings->pool_size, 1),
+        MAX (settings->memory_budget, 0),
+        websettings, (EEViewPoolSetupFunc) setup_webview, mainwin);
+    mainwin->visible = (EEPoolView *) g_queue_peek_head (&mainwin->pool->lru);
+    mainwin->webview = mainwin->visible->webview;
+    gtk_box_pack_start(GTK_BOX (vbox), ee_view_pool_get_widget (mainwin->pool), TRUE, TRUE, 0);
+
+    /* in tile mode, a grid of panes takes the place of the pool, which is
+     * kept (but never shown) for the shared web settings */
+    if (settings->tile_rows * settings->tile_columns > 1) {
+        mainwin->grid = ee_tile_grid_new (settings, mainwin->scheduler,
+            settings->tile_rows, settings->tile_columns,
+            websettings, (EETileGridSetupFunc) setup_tile_webview,
+            (EETileGridLoadFunc) on_tile_load, mainwin);
+        ee_tile_grid_set_partition (mainwin->grid, MAX (monitor, 0), mainwin->n_monitors);
+        gtk_widget_set_no_show_all (ee_view_pool_get_widget (mainwin->pool), TRUE);
+        gtk_box_pack_start(GTK_BOX (vbox), ee_tile_grid_get_widget (mainwin->grid), TRUE, TRUE, 0);
+        if (settings->snapshot_mode)
+            g_warning ("snapshot-mode is ignored in tile mode");
+    }
+
+    /* in snapshot mode, pages are rendered offscreen and shown as images */
+    else if (settings->snapshot_mode) {
+        mainwin->snapshots = ee_snapshots_new (settings->urls, MAX (settings->snapshot_interval, 1),
+            websettings, (EESnapshotsSetupFunc) setup_snapshot_webview,
+            (EESnapshotsTimeoutFunc) get_load_timeout, mainwin);
+        ee_snapshots_set_partition (mainwin->snapshots, MAX (monitor, 0), mainwin->n_monitors);
+        mainwin->snapshot_box = gtk_event_box_new ();
+        gtk_widget_add_events (mainwin->snapshot_box, GDK_BUTTON_PRESS_MASK | GDK_SCROLL_MASK);
+        g_signal_connect (mainwin->snapshot_box, "button-press-event",
+            G_CALLBACK (on_snapshot_event), mainwin);
+        g_signal_connect (mainwin->snapshot_box, "scroll-event",
+            G_CALLBACK (on_snapshot_event), mainwin);
+        mainwin->snapshot_image = GTK_IMAGE (gtk_image_new ());
+        gtk_container_add (GTK_CONTAINER (mainwin->snapshot_box), GTK_WIDGET (mainwin->snapshot_image));
+        gtk_widget_show (GTK_WIDGET (mainwin->snapshot_image));
+        /* the box is only shown while there is a snapshot to show */
+        gtk_widget_set_no_show_all (mainwin->snapshot_box, TRUE);
+        gtk_box_pack_start(GTK_BOX (vbox), mainwin->snapshot_box, TRUE, TRUE, 0);
+        g_signal_connect (ee_view_pool_get_widget (mainwin->pool), "size-allocate",
+            G_CALLBACK (on_size_allocate), mainwin);
+        g_signal_connect (mainwin->snapshot_box, "size-allocate",
+            G_CALLBACK (on_size_allocate), mainwin);
+    }
+    g_object_unref (websettings);
         
-    /* configure the SoupSession */
+    /* the network stack is shared by all windows, so only the first one
+     * sets it up */
+    if (settings->auth == NULL)
+        setup_session (settings);
     mainwin->session = webkit_get_default_session ();
-    g_signal_connect (mainwin->session, "authenticate",
-        G_CALLBACK (on_http_auth), mainwin);
-    soup_session_remove_feature_by_type (mainwin->session, WEBKIT_TYPE_SOUP_AUTH_DIALOG);
-    if (settings->cookie_jar)
-        soup_session_add_feature (mainwin->session, SOUP_SESSION_FEATURE (settings->cookie_jar));
-
-    /* put the webview in a scrolled window and put that in the vbox */
-    sw = gtk_scrolled_window_new (NULL, NULL);
-    gtk_scrolled_window_set_policy(GTK_SCROLLED_WINDOW (sw),
-        GTK_POLICY_AUTOMATIC, GTK_POLICY_AUTOMATIC);
-    gtk_container_add(GTK_CONTAINER (sw), webview);
-    gtk_box_pack_start(GTK_BOX (vbox), sw, TRUE, TRUE, 0);
+    mainwin->auth = settings->auth;
+    if (metrics)
+        ee_scheduler_set_drift_func (mainwin->scheduler,
+            (EESchedulerDriftFunc) ee_metrics_record_drift, metrics);
+    windows = g_list_append (windows, mainwin);
 
     /* add a separator to look nice :) */
     gtk_box_pack_start(GTK_BOX (vbox), gtk_hseparator_new (), FALSE, FALSE, 0);
@@ -449,7 +1595,7 @@ ee_main_window_construct(EESettings *settings)
 
     /* if window geometry was specified, then set it now */
     gtk_widget_show_all (GTK_WIDGET (vbox));
-    if (settings->window_geometry) {
+    if (settings->window_geometry && monitor < 0) {
         if (!gtk_window_parse_geometry (window, settings->window_geometry))
             g_warning ("failed to parse window geometry '%s'", settings->window_geometry);
         else
@@ -464,13 +1610,18 @@ ee_main_window_construct(EESettings *settings)
         gtk_window_fullscreen (window);
     }
 
-    /* load the first URL */
+    /* the tile grid is already cycling */
+    if (mainwin->grid)
+        return window;
+
+    /* load the first URL, or the one which is due now if the cycle is
+     * aligned to the clock */
+    if (settings->aligned_cycle)
+        mainwin->curr_url = get_aligned_slot (mainwin, g_get_real_time () / 1000, NULL);
     load_url (mainwin);
 
     /* start running the timeout function */
-    mainwin->timeout_id = g_timeout_add_seconds (mainwin->settings->cycle_time,
-        (GSourceFunc) on_timeout, mainwin);
-    g_debug ("next cycle is scheduled in %i seconds", mainwin->settings->cycle_time);
+    start_cycle (mainwin);
 
     return window;
 }
@@ -4,17 +4,44 @@
 #include <gtk/gtk.h>
 #include <webkit/webkit.h>
 #include <ee-settings.h>
+#include <ee-view-pool.h>
+#include <ee-snapshots.h>
+#include <ee-scheduler.h>
+#include <ee-auth-cache.h>
+#include <ee-tile-grid.h>
 
 typedef struct {
     EESettings *settings;
     GtkWindow *window;
+    EEViewPool *pool;
+    EEScheduler *scheduler;
+    GHashTable *failures;
+    GHashTable *profile_settings;
+    EEPoolView *visible;
+    EEPoolView *preload;
+    EESnapshots *snapshots;
+    EETileGrid *grid;
+    GtkWidget *snapshot_box;
+    GtkImage *snapshot_image;
     WebKitWebView *webview;
     SoupSession *session;
+    EEAuthCache *auth;
     GtkLabel *status;
+    gint monitor;
+    gint n_monitors;
     guint timeout_id;
-    GList *curr_url;
+    guint preload_id;
+    guint warmup_id;
+    gint64 slot_end;
+    gint curr_url;
+    gint preload_url;
+    gboolean swap_pending;
+    gboolean loading;
+    gboolean interactive;
+    gboolean showing_snapshot;
 } EEMainWindow;
 
-GtkWindow *ee_main_window_construct (EESettings *settings);
+GtkWindow *ee_main_window_construct (EESettings *settings, gint monitor, gint n_monitors);
+void ee_main_window_set_web_setting (EEMainWindow *mainwin, const gchar *property, gboolean value);
 
 #endif
@@ -0,0 +1,353 @@
+#include <string.h>
+#include <glib.h>
+#include <libsoup/soup.h>
+#include <ee-metrics.h>
+#include <ee-view-pool.h>
+
+/* URLs beyond this many are counted together, so that following links
+ * interactively can't grow the metrics without bound */
+#define EE_METRICS_MAX_URLS 256
+#define EE_METRICS_OTHER_URL "other"
+
+/* upper bounds of the histogram buckets in seconds, the last bucket is
+ * everything above */
+static const gdouble latency_bounds[EE_METRICS_BUCKETS - 1] = {
+    0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0, 30.0, 60.0
+};
+static const gdouble drift_bounds[EE_METRICS_BUCKETS - 1] = {
+    0.001, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 1.0, 5.0
+};
+
+/*
+ * ee_histogram_observe: add the value in seconds to histogram.  this only
+ *   ever runs on the main loop, as does the scrape, so no locking is
+ *   needed.
+ */
+void
+ee_histogram_observe (EEHistogram *histogram, gdouble value)
+{
+    guint i;
+
+    for (i = 0; i < EE_METRICS_BUCKETS - 1; i++)
+        if (value <= histogram->bounds[i])
+            break;
+    histogram->counts[i]++;
+    histogram->count++;
+    histogram->sum += value;
+}
+
+/*
+ * append_double: append value in the C locale, whatever the UI locale is.
+ */
+static void
+append_double (GString *out, gdouble value)
+{
+    gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+    g_string_append (out, g_ascii_formatd (buf, sizeof (buf), "%g", value));
+}
+
+/*
+ * append_label: append a url label, escaped as the exposition format
+ *   requires.
+ */
+static void
+append_label (GString *out, const gchar *url)
+{
+    const gchar *s;
+
+    g_string_append (out, "url=\"");
+    for (s = url; *s; s++) {
+        if (*s == '\\' || *s == '"')
+            g_string_append_c (out, '\\');
+        if (*s == '\n')
+            g_string_append (out, "\\n");
+        else
+            g_string_append_c (out, *s);
+    }
+    g_string_append_c (out, '"');
+}
+
+/*
+ * append_histogram: append the series of histogram called name, with the
+ *   url label if url isn't NULL.  the bucket counts are cumulative.
+ */
+static void
+append_histogram (GString *out, const gchar *name, const gchar *url, EEHistogram *histogram)
+{
+    guint64 total = 0;
+    guint i;
+
+    for (i = 0; i < EE_METRICS_BUCKETS; i++) {
+        total += histogram->counts[i];
+        g_string_append_printf (out, "%s_bucket{", name);
+        if (url) {
+            append_label (out, url);
+            g_string_append_c (out, ',');
+        }
+        g_string_append (out, "le=\"");
+        if (i < EE_METRICS_BUCKETS - 1)
+            append_double (out, histogram->bounds[i]);
+        else
+            g_string_append (out, "+Inf");
+        g_string_append_printf (out, "\"} %" G_GUINT64_FORMAT "\n", total);
+    }
+    g_string_append_printf (out, "%s_sum", name);
+    if (url) {
+        g_string_append_c (out, '{');
+        append_label (out, url);
+        g_string_append_c (out, '}');
+    }
+    g_string_append_c (out, ' ');
+    append_double (out, histogram->sum);
+    g_string_append_printf (out, "\n%s_count", name);
+    if (url) {
+        g_string_append_c (out, '{');
+        append_label (out, url);
+        g_string_append_c (out, '}');
+    }
+    g_string_append_printf (out, " %" G_GUINT64_FORMAT "\n", histogram->count);
+}
+
+/*
+ * append_counter: append a per-URL series for each URL, with the value at
+ *   offset in its EEUrlMetrics.
+ */
+static void
+append_counter (GString *out, EEMetrics *metrics, const gchar *name, const gchar *outcome,
+                gsize offset)
+{
+    GHashTableIter iter;
+    const gchar *url;
+    EEUrlMetrics *m;
+
+    g_hash_table_iter_init (&iter, metrics->urls);
+    while (g_hash_table_iter_next (&iter, (gpointer *) &url, (gpointer *) &m)) {
+        g_string_append_printf (out, "%s{", name);
+        append_label (out, url);
+        if (outcome)
+            g_string_append_printf (out, ",outcome=\"%s\"", outcome);
+        g_string_append_printf (out, "} %" G_GUINT64_FORMAT "\n",
+            G_STRUCT_MEMBER (guint64, m, offset));
+    }
+}
+
+/*
+ * format_metrics: returns the metrics in the Prometheus text exposition
+ *   format.
+ */
+static GString *
+format_metrics (EEMetrics *metrics)
+{
+    GString *out = g_string_sized_new (4096);
+    EESettings *settings = metrics->settings;
+    GHashTableIter iter;
+    const gchar *url;
+    EEUrlMetrics *m;
+
+    g_string_append (out, "# HELP eagle_eye_load_seconds Time from navigation start until a page load ends.\n"
+                          "# TYPE eagle_eye_load_seconds histogram\n");
+    g_hash_table_iter_init (&iter, metrics->urls);
+    while (g_hash_table_iter_next (&iter, (gpointer *) &url, (gpointer *) &m))
+        append_histogram (out, "eagle_eye_load_seconds", url, &m->latency);
+
+    g_string_append (out, "# HELP eagle_eye_loads_total Page loads by outcome, timeout loads were stopped\n"
+                          "# for taking longer than the load timeout, cancelled ones were abandoned.\n"
+                          "# TYPE eagle_eye_loads_total counter\n");
+    append_counter (out, metrics, "eagle_eye_loads_total", "ok", G_STRUCT_OFFSET (EEUrlMetrics, ok));
+    append_counter (out, metrics, "eagle_eye_loads_total", "failed", G_STRUCT_OFFSET (EEUrlMetrics, failed));
+    append_counter (out, metrics, "eagle_eye_loads_total", "cancelled",
+        G_STRUCT_OFFSET (EEUrlMetrics, cancelled));
+    append_counter (out, metrics, "eagle_eye_loads_total", "timeout", G_STRUCT_OFFSET (EEUrlMetrics, timeout));
+    g_string_append (out, "# HELP eagle_eye_requests_total HTTP requests made for page loads.\n"
+                          "# TYPE eagle_eye_requests_total counter\n");
+    append_counter (out, metrics, "eagle_eye_requests_total", NULL, G_STRUCT_OFFSET (EEUrlMetrics, requests));
+    g_string_append (out, "# HELP eagle_eye_received_bytes_total Response body bytes received for page loads.\n"
+                          "# TYPE eagle_eye_received_bytes_total counter\n");
+    append_counter (out, metrics, "eagle_eye_received_bytes_total", NULL, G_STRUCT_OFFSET (EEUrlMetrics, bytes));
+
+    g_string_append (out, "# HELP eagle_eye_timer_drift_seconds How late scheduled cycle events run.\n"
+                          "# TYPE eagle_eye_timer_drift_seconds histogram\n");
+    append_histogram (out, "eagle_eye_timer_drift_seconds", NULL, &metrics->drift);
+
+    if (settings->aligned_cycle) {
+        g_string_append (out, "# HELP eagle_eye_cycle_jitter_seconds How far aligned cycles switch from the slot boundary.\n"
+                              "# TYPE eagle_eye_cycle_jitter_seconds histogram\n");
+        append_histogram (out, "eagle_eye_cycle_jitter_seconds", NULL, &metrics->jitter);
+    }
+
+    if (metrics->main_loop) {
+        g_string_append (out, "# HELP eagle_eye_main_loop_latency_seconds How long watchdog pings waited to be dispatched.\n"
+                              "# TYPE eagle_eye_main_loop_latency_seconds histogram\n");
+        append_histogram (out, "eagle_eye_main_loop_latency_seconds", NULL, metrics->main_loop);
+    }
+
+    g_string_append (out, "# HELP eagle_eye_settings_save_seconds Main loop time spent queueing settings writes.\n"
+                          "# TYPE eagle_eye_settings_save_seconds summary\n"
+                          "eagle_eye_settings_save_seconds_sum ");
+    append_double (out, settings->save_time / (gdouble) G_USEC_PER_SEC);
+    g_string_append_printf (out, "\neagle_eye_settings_save_seconds_count %u\n", settings->saves);
+
+    g_string_append_printf (out, "# HELP eagle_eye_resident_memory_bytes Resident set size of the process.\n"
+                                 "# TYPE eagle_eye_resident_memory_bytes gauge\n"
+                                 "eagle_eye_resident_memory_bytes %lu\n",
+        ee_view_pool_get_resident_size () * 1024);
+
+    if (settings->cache) {
+        g_string_append_printf (out, "# HELP eagle_eye_http_cache_max_bytes Size limit of the HTTP cache.\n"
+                                     "# TYPE eagle_eye_http_cache_max_bytes gauge\n"
+                                     "eagle_eye_http_cache_max_bytes %u\n"
+                                     "# HELP eagle_eye_http_cache_requests_total HTTP cache lookups by result.\n"
+                                     "# TYPE eagle_eye_http_cache_requests_total counter\n"
+                                     "eagle_eye_http_cache_requests_total{result=\"hit\"} %u\n"
+                                     "eagle_eye_http_cache_requests_total{result=\"revalidated\"} %u\n"
+                                     "eagle_eye_http_cache_requests_total{result=\"not_modified\"} %u\n"
+                                     "eagle_eye_http_cache_requests_total{result=\"miss\"} %u\n",
+            soup_cache_get_max_size (settings->cache->cache),
+            settings->cache->hits, settings->cache->revalidations,
+            settings->cache->not_modified, settings->cache->misses);
+    }
+
+    g_string_append_printf (out, "# HELP eagle_eye_urls Entries in the playlist.\n"
+                                 "# TYPE eagle_eye_urls gauge\n"
+                                 "eagle_eye_urls %u\n",
+        ee_playlist_length (settings->urls));
+    return out;
+}
+
+/*
+ * on_metrics_request: serve the metrics.
+ */
+static void
+on_metrics_request (SoupServer *            server,
+                    SoupMessage *           message,
+                    const char *            path,
+                    GHashTable *            query,
+                    SoupClientContext *     client,
+                    EEMetrics *             metrics)
+{
+    GString *out;
+    gsize len;
+
+    if (message->method != SOUP_METHOD_GET && message->method != SOUP_METHOD_HEAD) {
+        soup_message_set_status (message, SOUP_STATUS_METHOD_NOT_ALLOWED);
+        return;
+    }
+    if (strcmp (path, "/metrics") != 0) {
+        soup_message_set_status (message, SOUP_STATUS_NOT_FOUND);
+        return;
+    }
+    out = format_metrics (metrics);
+    len = out->len;
+    soup_message_set_response (message, "text/plain; version=0.0.4",
+        SOUP_MEMORY_TAKE, g_string_free (out, FALSE), len);
+    soup_message_set_status (message, SOUP_STATUS_OK);
+}
+
+/*
+ * ee_metrics_new: serve metrics at http://127.0.0.1:port/metrics.  the
+ *   server only listens on the loopback interface, since the metrics
+ *   include the URLs being shown.  returns NULL if the port can't be
+ *   bound.
+ */
+EEMetrics *
+ee_metrics_new (EESettings *settings, guint port)
+{
+    EEMetrics *metrics;
+    SoupAddress *address;
+    SoupServer *server;
+
+    address = soup_address_new ("127.0.0.1", port);
+    if (soup_address_resolve_sync (address, NULL) != SOUP_STATUS_OK) {
+        g_warning ("failed to resolve the metrics address");
+        g_object_unref (address);
+        return NULL;
+    }
+    server = soup_server_new (SOUP_SERVER_INTERFACE, address, NULL);
+    g_object_unref (address);
+    if (server == NULL) {
+        g_warning ("failed to listen on port %u for metrics", port);
+        return NULL;
+    }
+
+    metrics = g_new0 (EEMetrics, 1);
+    metrics->settings = settings;
+    metrics->server = server;
+    metrics->urls = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+    metrics->drift.bounds = drift_bounds;
+    metrics->jitter.bounds = drift_bounds;
+    soup_server_add_handler (server, "/metrics",
+        (SoupServerCallback) on_metrics_request, metrics, NULL);
+    soup_server_run_async (server);
+    g_debug ("serving metrics on http://127.0.0.1:%u/metrics", port);
+    return metrics;
+}
+
+/*
+ * ee_metrics_record_load: count a page load which ended with outcome after
+ *   duration microseconds.  this is an EELoadLogFunc.
+ */
+void
+ee_metrics_record_load (const gchar *   url,
+                        const gchar *   outcome,
+                        gint64          duration,
+                        guint           requests,
+                        guint64         bytes,
+                        EEMetrics *     metrics)
+{
+    EEUrlMetrics *m;
+
+    m = g_hash_table_lookup (metrics->urls, url);
+    if (m == NULL && g_hash_table_size (metrics->urls) >= EE_METRICS_MAX_URLS) {
+        url = EE_METRICS_OTHER_URL;
+        m = g_hash_table_lookup (metrics->urls, url);
+    }
+    if (m == NULL) {
+        m = g_new0 (EEUrlMetrics, 1);
+        m->latency.bounds = latency_bounds;
+        g_hash_table_insert (metrics->urls, g_strdup (url), m);
+    }
+    ee_histogram_observe (&m->latency, duration / (gdouble) G_USEC_PER_SEC);
+    if (!strcmp (outcome, "ok"))
+        m->ok++;
+    else if (!strcmp (outcome, "cancelled"))
+        m->cancelled++;
+    else if (!strcmp (outcome, "timeout"))
+        m->timeout++;
+    else
+        m->failed++;
+    m->requests += requests;
+    m->bytes += bytes;
+}
+
+/*
+ * ee_metrics_record_drift: observe a scheduled event running drift
+ *   milliseconds late.  this is an EESchedulerDriftFunc.
+ */
+void
+ee_metrics_record_drift (gint64 drift, EEMetrics *metrics)
+{
+    ee_histogram_observe (&metrics->drift, MAX (drift, 0) / 1000.0);
+}
+
+/*
+ * ee_metrics_record_jitter: observe an aligned cycle switching jitter
+ *   milliseconds early or late.
+ */
+void
+ee_metrics_record_jitter (gint64 jitter, EEMetrics *metrics)
+{
+    ee_histogram_observe (&metrics->jitter, ABS (jitter) / 1000.0);
+}
+
+/*
+ * ee_metrics_free: stop serving metrics and free them.
+ */
+void
+ee_metrics_free (EEMetrics *metrics)
+{
+    soup_server_quit (metrics->server);
+    g_object_unref (metrics->server);
+    g_hash_table_destroy (metrics->urls);
+    g_free (metrics);
+}
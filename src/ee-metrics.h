@@ -0,0 +1,46 @@
+#ifndef EE_METRICS_H
+#define EE_METRICS_H
+
+#include <glib.h>
+#include <libsoup/soup.h>
+#include <ee-settings.h>
+
+/* the number of buckets in a histogram, including the +Inf bucket */
+#define EE_METRICS_BUCKETS 10
+
+typedef struct {
+    const gdouble *bounds;
+    guint64 counts[EE_METRICS_BUCKETS];
+    guint64 count;
+    gdouble sum;
+} EEHistogram;
+
+typedef struct {
+    EEHistogram latency;
+    guint64 ok;
+    guint64 failed;
+    guint64 cancelled;
+    guint64 timeout;
+    guint64 requests;
+    guint64 bytes;
+} EEUrlMetrics;
+
+typedef struct {
+    EESettings *settings;
+    SoupServer *server;
+    GHashTable *urls;
+    EEHistogram drift;
+    EEHistogram jitter;
+    EEHistogram *main_loop;
+} EEMetrics;
+
+void ee_histogram_observe (EEHistogram *histogram, gdouble value);
+
+EEMetrics *ee_metrics_new (EESettings *settings, guint port);
+void ee_metrics_record_load (const gchar *url, const gchar *outcome, gint64 duration,
+                             guint requests, guint64 bytes, EEMetrics *metrics);
+void ee_metrics_record_drift (gint64 drift, EEMetrics *metrics);
+void ee_metrics_record_jitter (gint64 jitter, EEMetrics *metrics);
+void ee_metrics_free (EEMetrics *metrics);
+
+#endif
@@ -0,0 +1,320 @@
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <ee-persist.h>
+#include <ee-trace.h>
+
+typedef struct {
+    gchar *path;
+    gchar *data;
+    gsize len;
+    gboolean append;
+    gchar *target;
+} EEPersistJob;
+
+/*
+ * sync_directory: flush the directory containing path to stable storage,
+ *   so that a file just renamed into it survives a crash.
+ */
+static void
+sync_directory (const gchar *path)
+{
+    gchar *dir;
+    gint fd;
+
+    dir = g_path_get_dirname (path);
+    fd = g_open (dir, O_RDONLY, 0);
+    if (fd < 0)
+        g_warning ("failed to open %s: %s", dir, g_strerror (errno));
+    else {
+        if (fsync (fd) < 0)
+            g_warning ("error syncing %s: %s", dir, g_strerror (errno));
+        close (fd);
+    }
+    g_free (dir);
+}
+
+/*
+ * write_file_atomically: write data to a temporary file next to path, flush
+ *   it to stable storage, then rename it over path, keeping its permissions.
+ *   readers see either the old contents or the new contents, never a
+ *   partially written file.
+ */
+static gboolean
+write_file_atomically (const gchar *path, const gchar *data, gsize len)
+{
+    gchar *tmp_file;
+    gint fd;
+    gssize nwritten;
+    struct stat st;
+    mode_t mode;
+
+    tmp_file = g_strdup_printf ("%s.XXXXXX", path);
+    fd = g_mkstemp (tmp_file);
+    if (fd < 0) {
+        g_critical ("failed to create temporary file for %s: %s", path, g_strerror (errno));
+        g_free (tmp_file);
+        return FALSE;
+    }
+    /* mkstemp creates the file readable only by its owner, so give it the
+     * permissions of the file it replaces */
+    mode = g_stat (path, &st) == 0 ? st.st_mode & 07777 : 0644;
+    if (fchmod (fd, mode) < 0)
+        g_warning ("failed to set permissions of %s: %s", tmp_file, g_strerror (errno));
+    while (len > 0) {
+        nwritten = write (fd, data, len);
+        if (nwritten < 0) {
+            if (errno == EINTR)
+                continue;
+            g_critical ("error writing %s: %s", tmp_file, g_strerror (errno));
+            goto fail;
+        }
+        data += nwritten;
+        len -= nwritten;
+    }
+    if (fsync (fd) < 0) {
+        g_critical ("error syncing %s: %s", tmp_file, g_strerror (errno));
+        goto fail;
+    }
+    if (close (fd) < 0) {
+        fd = -1;
+        g_critical ("error closing %s: %s", tmp_file, g_strerror (errno));
+        goto fail;
+    }
+    fd = -1;
+    if (g_rename (tmp_file, path) < 0) {
+        g_critical ("failed to rename %s to %s: %s", tmp_file, path, g_strerror (errno));
+        goto fail;
+    }
+    sync_directory (path);
+    g_free (tmp_file);
+    return TRUE;
+
+    fail:
+    if (fd >= 0)
+        close (fd);
+    g_unlink (tmp_file);
+    g_free (tmp_file);
+    return FALSE;
+}
+
+/*
+ * append_file: append data to the end of path, creating it if necessary,
+ *   and flush it to stable storage.  a crash can leave a partially written
+ *   record at the end of the file, so readers must ignore an unterminated
+ *   last line.
+ */
+static gboolean
+append_file (const gchar *path, const gchar *data, gsize len)
+{
+    gint fd;
+    gssize nwritten;
+
+    fd = g_open (path, O_WRONLY | O_APPEND | O_CREAT, 0644);
+    if (fd < 0) {
+        g_critical ("failed to open %s: %s", path, g_strerror (errno));
+        return FALSE;
+    }
+    while (len > 0) {
+        nwritten = write (fd, data, len);
+        if (nwritten < 0) {
+            if (errno == EINTR)
+                continue;
+            g_critical ("error writing %s: %s", path, g_strerror (errno));
+            close (fd);
+            return FALSE;
+        }
+        data += nwritten;
+        len -= nwritten;
+    }
+    if (fsync (fd) < 0) {
+        g_critical ("error syncing %s: %s", path, g_strerror (errno));
+        close (fd);
+        return FALSE;
+    }
+    if (close (fd) < 0) {
+        g_critical ("error closing %s: %s", path, g_strerror (errno));
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/*
+ * persist_thread: write each queued job to disk in order, until we pop a
+ *   job without a path, which tells the thread to exit.
+ */
+static gpointer
+persist_thread (EEPersist *persist)
+{
+    EEPersistJob *job;
+    gboolean done = FALSE;
+
+    while (!done) {
+        job = (EEPersistJob *) g_async_queue_pop (persist->queue);
+        if (job->path && job->target) {
+            EE_TRACE_BEGIN ("persist", "rename", job->path);
+            if (g_rename (job->path, job->target) < 0 && errno != ENOENT)
+                g_critical ("failed to rename %s to %s: %s", job->path, job->target,
+                    g_strerror (errno));
+            EE_TRACE_END ("persist", "rename");
+        }
+        else if (job->path && job->append) {
+            EE_TRACE_BEGIN ("persist", "append_file", job->path);
+            if (append_file (job->path, job->data, job->len))
+                g_debug ("appended %" G_GSIZE_FORMAT " bytes to %s", job->len, job->path);
+            EE_TRACE_END ("persist", "append_file");
+        }
+        else if (job->path) {
+            EE_TRACE_BEGIN ("persist", "write_file_atomically", job->path);
+            if (write_file_atomically (job->path, job->data, job->len))
+                g_debug ("wrote %s", job->path);
+            EE_TRACE_END ("persist", "write_file_atomically");
+        }
+        else
+            done = TRUE;
+        g_free (job->path);
+        g_free (job->data);
+        g_free (job->target);
+        g_free (job);
+
+        /* wake up anybody waiting in ee_persist_sync */
+        g_mutex_lock (persist->lock);
+        persist->pending--;
+        g_cond_broadcast (persist->cond);
+        g_mutex_unlock (persist->lock);
+    }
+    return NULL;
+}
+
+/*
+ * push_job: hand a job to the persistence thread.
+ */
+static void
+push_job (EEPersist *persist, EEPersistJob *job)
+{
+    g_mutex_lock (persist->lock);
+    persist->pending++;
+    g_mutex_unlock (persist->lock);
+    g_async_queue_push (persist->queue, job);
+}
+
+/*
+ * ee_persist_new: create a new persistence object and start its thread.
+ *   returns NULL if the thread couldn't be created.
+ */
+EEPersist *
+ee_persist_new (void)
+{
+    EEPersist *persist;
+    GError *error = NULL;
+
+    persist = g_new0 (EEPersist, 1);
+    persist->queue = g_async_queue_new ();
+    persist->lock = g_mutex_new ();
+    persist->cond = g_cond_new ();
+    persist->pending = 0;
+    persist->thread = g_thread_create ((GThreadFunc) persist_thread, persist, TRUE, &error);
+    if (persist->thread == NULL) {
+        g_critical ("failed to start persistence thread: %s", error->message);
+        g_error_free (error);
+        g_async_queue_unref (persist->queue);
+        g_mutex_free (persist->lock);
+        g_cond_free (persist->cond);
+        g_free (persist);
+        return NULL;
+    }
+    return persist;
+}
+
+/*
+ * ee_persist_write: queue data to be written atomically to path.  the
+ *   persist object takes ownership of data, which must have been allocated
+ *   with g_malloc.  writes are performed in the order they were queued.
+ */
+void
+ee_persist_write (EEPersist *persist, const gchar *path, gchar *data, gsize len)
+{
+    EEPersistJob *job;
+
+    g_assert (persist != NULL);
+    g_assert (path != NULL);
+
+    job = g_new0 (EEPersistJob, 1);
+    job->path = g_strdup (path);
+    job->data = data;
+    job->len = len;
+    push_job (persist, job);
+}
+
+/*
+ * ee_persist_append: queue data to be appended to path.  the persist object
+ *   takes ownership of data, which must have been allocated with g_malloc.
+ *   appends are ordered with respect to writes, so an append queued after
+ *   a write lands in the newly written file.
+ */
+void
+ee_persist_append (EEPersist *persist, const gchar *path, gchar *data, gsize len)
+{
+    EEPersistJob *job;
+
+    g_assert (persist != NULL);
+    g_assert (path != NULL);
+
+    job = g_new0 (EEPersistJob, 1);
+    job->path = g_strdup (path);
+    job->data = data;
+    job->len = len;
+    job->append = TRUE;
+    push_job (persist, job);
+}
+
+/*
+ * ee_persist_rename: queue path to be renamed to target, replacing target
+ *   if it exists.  it isn't an error if path doesn't exist.  renames are
+ *   ordered with respect to writes and appends, which is what rotating a
+ *   log needs.
+ */
+void
+ee_persist_rename (EEPersist *persist, const gchar *path, const gchar *target)
+{
+    EEPersistJob *job;
+
+    g_assert (persist != NULL);
+    g_assert (path != NULL);
+    g_assert (target != NULL);
+
+    job = g_new0 (EEPersistJob, 1);
+    job->path = g_strdup (path);
+    job->target = g_strdup (target);
+    push_job (persist, job);
+}
+
+/*
+ * ee_persist_sync: block until all queued writes have completed.
+ */
+void
+ee_persist_sync (EEPersist *persist)
+{
+    g_mutex_lock (persist->lock);
+    while (persist->pending > 0)
+        g_cond_wait (persist->cond, persist->lock);
+    g_mutex_unlock (persist->lock);
+}
+
+/*
+ * ee_persist_free: finish all queued writes, stop the persistence thread,
+ *   and free all memory associated with the persist object.
+ */
+void
+ee_persist_free (EEPersist *persist)
+{
+    push_job (persist, g_new0 (EEPersistJob, 1));
+    g_thread_join (persist->thread);
+    g_async_queue_unref (persist->queue);
+    g_mutex_free (persist->lock);
+    g_cond_free (persist->cond);
+    g_free (persist);
+}
@@ -0,0 +1,21 @@
+#ifndef EE_PERSIST_H
+#define EE_PERSIST_H
+
+#include <glib.h>
+
+typedef struct {
+    GThread *thread;
+    GAsyncQueue *queue;
+    GMutex *lock;
+    GCond *cond;
+    guint pending;
+} EEPersist;
+
+EEPersist *ee_persist_new (void);
+void ee_persist_write (EEPersist *persist, const gchar *path, gchar *data, gsize len);
+void ee_persist_append (EEPersist *persist, const gchar *path, gchar *data, gsize len);
+void ee_persist_rename (EEPersist *persist, const gchar *path, const gchar *target);
+void ee_persist_sync (EEPersist *persist);
+void ee_persist_free (EEPersist *persist);
+
+#endif
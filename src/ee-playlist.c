@@ -0,0 +1,775 @@
+#include <string.h>
+#include <glib.h>
+#include <libsoup/soup.h>
+#include <ee-playlist.h>
+
+/* number of entries allocated at a time */
+#define EE_PLAYLIST_BLOCK_SIZE 1024
+
+/*
+ * alloc_url: allocate an entry.  entries are carved out of large blocks,
+ *   and removed entries are recycled, rather than allocating each one.
+ */
+static EEUrl *
+alloc_url (EEPlaylist *playlist)
+{
+    EEUrl *url;
+
+    url = playlist->free_urls;
+    if (url)
+        playlist->free_urls = url->next_dup;
+    else {
+        if (playlist->block == NULL || playlist->block_used == EE_PLAYLIST_BLOCK_SIZE) {
+            playlist->block = g_new (EEUrl, EE_PLAYLIST_BLOCK_SIZE);
+            g_ptr_array_add (playlist->blocks, playlist->block);
+            playlist->block_used = 0;
+        }
+        url = &playlist->block[playlist->block_used++];
+    }
+    memset (url, 0, sizeof (EEUrl));
+    return url;
+}
+
+/*
+ * get_strings_size: returns how many bytes the entry's strings take up in
+ *   the arena.  strings shared with the text are only counted once.
+ */
+static gsize
+get_strings_size (EEUrl *url)
+{
+    gsize size;
+
+    size = strlen (url->text) + 1;
+    if (url->key && url->key != url->text)
+        size += strlen (url->key) + 1;
+    if (url->display && url->display != url->text && url->display != url->key)
+        size += strlen (url->display) + 1;
+    return size;
+}
+
+/*
+ * free_url: return the entry to the free list, which is linked through
+ *   next_dup since a free entry has no duplicates.  its strings stay in
+ *   the arena until ee_playlist_compact, so they are counted as garbage.
+ */
+static void
+free_url (EEPlaylist *playlist, EEUrl *url)
+{
+    playlist->garbage += get_strings_size (url);
+    url->next_dup = playlist->free_urls;
+    playlist->free_urls = url;
+}
+
+/*
+ * insert_string: copy str into the arena, unless it is the same as other
+ *   (which is already in the arena), in which case other is shared.
+ */
+static const gchar *
+insert_string (EEPlaylist *playlist, const gchar *str, const gchar *other)
+{
+    if (other && !strcmp (str, other))
+        return other;
+    return g_string_chunk_insert (playlist->strings, str);
+}
+
+/*
+ * fill_url: copy the parts of uri that are used while cycling into the
+ *   entry.  hosts, schemes and credentials are repeated across many
+ *   entries, so they are interned rather than copied.
+ */
+static void
+fill_url (EEPlaylist *playlist, EEUrl *url, SoupURI *uri)
+{
+    gchar *display;
+
+    /* soup interns the scheme itself */
+    url->scheme = uri->scheme;
+    url->host = g_string_chunk_insert_const (playlist->atoms, uri->host);
+    url->port = uri->port;
+    if (uri->user)
+        url->user = g_string_chunk_insert_const (playlist->atoms, uri->user);
+    if (uri->password)
+        url->password = g_string_chunk_insert_const (playlist->atoms, uri->password);
+    /* without credentials, the display string is usually the text */
+    display = soup_uri_to_string (uri, FALSE);
+    url->display = insert_string (playlist, display, url->text);
+    g_free (display);
+    url->parsed = TRUE;
+}
+
+/*
+ * parse_url: parse the entry text the first time the entry is used.
+ *   returns FALSE if the URL is not a valid HTTP URL.
+ */
+static gboolean
+parse_url (EEPlaylist *playlist, EEUrl *url)
+{
+    SoupURI *uri;
+
+    if (url->parsed || url->invalid)
+        return url->parsed;
+    uri = soup_uri_new (url->text);
+    if (uri && SOUP_URI_VALID_FOR_HTTP (uri))
+        fill_url (playlist, url, uri);
+    else {
+        g_warning ("ignoring URL %s: not a valid HTTP URL", url->text);
+        url->invalid = TRUE;
+    }
+    if (uri)
+        soup_uri_free (uri);
+    return url->parsed;
+}
+
+/*
+ * has_http_scheme: returns TRUE if text starts with an http or https scheme.
+ *   this is a cheap check done when loading, full validation is deferred
+ *   until the URL is parsed.
+ */
+static gboolean
+has_http_scheme (const gchar *text, gsize len)
+{
+    if (len > 7 && !g_ascii_strncasecmp (text, "http://", 7))
+        return TRUE;
+    if (len > 8 && !g_ascii_strncasecmp (text, "https://", 8))
+        return TRUE;
+    return FALSE;
+}
+
+/*
+ * parse_attributes: set the entry attributes from text of length len,
+ *   which holds whitespace separated NAME=VALUE pairs.  the attributes
+ *   are:
+ *
+ *   dwell=SECONDS      how long the URL is shown, instead of cycle-time
+ *   refresh=SECONDS    how often the URL is reloaded while it is retained
+ *   timeout=SECONDS    how long the URL may take to load, instead of
+ *                      load-timeout
+ *   profile=NAME       the render profile the URL is loaded with, from
+ *                      the [profile NAME] group of the config file
+ *
+ *   unknown attributes are ignored, so newer files can still be loaded.
+ */
+static void
+parse_attributes (EEPlaylist *playlist, EEUrl *url, const gchar *text, gsize len)
+{
+    const gchar *end = text + len, *name, *value;
+    gchar profile[EE_URL_PROFILE_MAX + 1];
+    gchar *endptr;
+    guint64 n;
+
+    while (text < end) {
+        while (text < end && g_ascii_isspace (*text))
+            text++;
+        name = text;
+        while (text < end && !g_ascii_isspace (*text) && *text != '=')
+            text++;
+        if (text == name)
+            break;
+        if (text == end || *text != '=') {
+            g_warning ("ignoring URL attribute %.*s: no value", (gint) (text - name), name);
+            continue;
+        }
+        value = ++text;
+        while (text < end && !g_ascii_isspace (*text))
+            text++;
+        if (value - name == 8 && !strncmp (name, "profile=", 8)) {
+            if (value == text || text - value > EE_URL_PROFILE_MAX) {
+                g_warning ("ignoring URL attribute %.*s: invalid value",
+                    (gint) (text - name), name);
+                continue;
+            }
+            /* profile names are shared by many entries, so intern them */
+            memcpy (profile, value, text - value);
+            profile[text - value] = '\0';
+            url->profile = g_string_chunk_insert_const (playlist->atoms, profile);
+            continue;
+        }
+        n = g_ascii_strtoull (value, &endptr, 10);
+        if (endptr != text || value == text || n > G_MAXUINT) {
+            g_warning ("ignoring URL attribute %.*s: invalid value",
+                (gint) (text - name), name);
+            continue;
+        }
+        if (value - name == 6 && !strncmp (name, "dwell=", 6))
+            url->dwell = (guint) n;
+        else if (value - name == 8 && !strncmp (name, "refresh=", 8))
+            url->refresh = (guint) n;
+        else if (value - name == 8 && !strncmp (name, "timeout=", 8))
+            url->timeout = (guint) n;
+        else
+            g_debug ("ignoring unknown URL attribute %.*s", (gint) (text - name), name);
+    }
+}
+
+/* characters which must be escaped in the userinfo part of a URL */
+#define EE_USERINFO_RESERVED ":;@/?#"
+
+/*
+ * format_uri: format uri as a line of the urls file.  unlike
+ *   soup_uri_to_string, the password is included.  the result parses
+ *   back into a URI equal to uri.
+ */
+static gchar *
+format_uri (SoupURI *uri)
+{
+    GString *str;
+    gchar *s;
+
+    str = g_string_new (NULL);
+    /* append the scheme */
+    if (uri->scheme == SOUP_URI_SCHEME_HTTP)
+        g_string_append_printf (str, "%s://", SOUP_URI_SCHEME_HTTP);
+    else if (uri->scheme == SOUP_URI_SCHEME_HTTPS)
+        g_string_append_printf (str, "%s://", SOUP_URI_SCHEME_HTTPS);
+    else {
+        g_string_free (str, TRUE);
+        return NULL;
+    }
+    /* append the username and password, which SoupURI stores decoded */
+    if (uri->user) {
+        s = soup_uri_encode (uri->user, EE_USERINFO_RESERVED);
+        g_string_append (str, s);
+        g_free (s);
+        if (uri->password) {
+            s = soup_uri_encode (uri->password, EE_USERINFO_RESERVED);
+            g_string_append_printf (str, ":%s", s);
+            g_free (s);
+        }
+        g_string_append_c (str, '@');
+    }
+    /* append the host, IPv6 literals need brackets */
+    if (strchr (uri->host, ':'))
+        g_string_append_printf (str, "[%s]", uri->host);
+    else
+        g_string_append (str, uri->host);
+    /* append the port, unless it is the default for the scheme */
+    if (!soup_uri_uses_default_port (uri))
+        g_string_append_printf (str, ":%u", uri->port);
+    /* append the path, query and fragment, which are stored encoded */
+    g_string_append (str, uri->path);
+    if (uri->query)
+        g_string_append_printf (str, "?%s", uri->query);
+    if (uri->fragment)
+        g_string_append_printf (str, "#%s", uri->fragment);
+    return g_string_free (str, FALSE);
+}
+
+/*
+ * add_key: add the entry to the index of normalized URLs.  entries with
+ *   the same key are chained together, newest first.
+ */
+static void
+add_key (EEPlaylist *playlist, EEUrl *url, const gchar *text, gsize len)
+{
+    gchar *key;
+
+    key = ee_url_normalize (text, len);
+    url->key = insert_string (playlist, key, url->text);
+    g_free (key);
+    url->next_dup = (EEUrl *) g_hash_table_lookup (playlist->keys, url->key);
+    g_hash_table_insert (playlist->keys, (gpointer) url->key, url);
+}
+
+/*
+ * remove_key: remove the entry from the index of normalized URLs.
+ */
+static void
+remove_key (EEPlaylist *playlist, EEUrl *url)
+{
+    EEUrl *head, *dup;
+
+    head = (EEUrl *) g_hash_table_lookup (playlist->keys, url->key);
+    if (head == url) {
+        if (url->next_dup)
+            g_hash_table_insert (playlist->keys, (gpointer) url->key, url->next_dup);
+        else
+            g_hash_table_remove (playlist->keys, url->key);
+        return;
+    }
+    for (dup = head; dup; dup = dup->next_dup) {
+        if (dup->next_dup == url) {
+            dup->next_dup = url->next_dup;
+            return;
+        }
+    }
+}
+
+/*
+ * renumber: update the index of each entry from first to the end of the
+ *   playlist, after entries have been shifted.
+ */
+static void
+renumber (EEPlaylist *playlist, guint first)
+{
+    guint i;
+
+    for (i = first; i < playlist->entries->len; i++)
+        ((EEUrl *) g_ptr_array_index (playlist->entries, i))->index = i;
+}
+
+/*
+ * insert_url: insert the entry at position.  if position is negative or
+ *   past the end of the playlist, then the entry is appended, which takes
+ *   amortized constant time.  cursors pointing at or after position are
+ *   moved along with their entries.
+ */
+static void
+insert_url (EEPlaylist *playlist, EEUrl *url, gint position)
+{
+    GPtrArray *entries = playlist->entries;
+    GSList *item;
+    gint *cursor;
+
+    url->index = entries->len;
+    g_ptr_array_add (entries, url);
+    if (position < 0 || (guint) position >= entries->len - 1)
+        return;
+
+    /* shift the tail of the array up by one to make room */
+    memmove (&entries->pdata[position + 1], &entries->pdata[position],
+        (entries->len - 1 - position) * sizeof (gpointer));
+    entries->pdata[position] = url;
+    renumber (playlist, position);
+
+    for (item = playlist->cursors; item; item = g_slist_next (item)) {
+        cursor = (gint *) item->data;
+        if (*cursor >= position)
+            (*cursor)++;
+    }
+    for (item = playlist->entry_cursors; item; item = g_slist_next (item)) {
+        cursor = (gint *) item->data;
+        if (*cursor >= position)
+            (*cursor)++;
+    }
+}
+
+/*
+ * ee_playlist_new: create a new empty playlist.
+ */
+EEPlaylist *
+ee_playlist_new (void)
+{
+    EEPlaylist *playlist;
+
+    playlist = g_new0 (EEPlaylist, 1);
+    playlist->entries = g_ptr_array_new ();
+    playlist->cursors = NULL;
+    playlist->entry_cursors = NULL;
+    playlist->keys = g_hash_table_new (g_str_hash, g_str_equal);
+    playlist->strings = g_string_chunk_new (64 * 1024);
+    playlist->garbage = 0;
+    playlist->atoms = g_string_chunk_new (4 * 1024);
+    playlist->blocks = g_ptr_array_new ();
+    playlist->block = NULL;
+    playlist->block_used = 0;
+    playlist->free_urls = NULL;
+    return playlist;
+}
+
+/*
+ * ee_playlist_length: returns the number of entries in the playlist.
+ */
+guint
+ee_playlist_length (EEPlaylist *playlist)
+{
+    return playlist->entries->len;
+}
+
+/*
+ * ee_playlist_get: returns the entry at index, or NULL if index is out of
+ *   range.  the playlist retains ownership of the entry.
+ */
+EEUrl *
+ee_playlist_get (EEPlaylist *playlist, gint index)
+{
+    if (index < 0 || (guint) index >= playlist->entries->len)
+        return NULL;
+    return (EEUrl *) g_ptr_array_index (playlist->entries, index);
+}
+
+/*
+ * ee_playlist_get_parsed: returns the entry at index, parsing its URL the
+ *   first time it is requested, or NULL if index is out of range or the
+ *   URL is invalid.  the playlist retains ownership of the entry.
+ */
+EEUrl *
+ee_playlist_get_parsed (EEPlaylist *playlist, gint index)
+{
+    EEUrl *url;
+
+    url = ee_playlist_get (playlist, index);
+    if (url == NULL || !parse_url (playlist, url))
+        return NULL;
+    return url;
+}
+
+/*
+ * ee_playlist_insert: insert the URL text of length len (or -1 if text is
+ *   nul-terminated) at position.  the URL may be followed by whitespace and
+ *   attributes, as in a line of the urls file.  the text is copied into
+ *   the playlist arena, but isn't parsed until it is first used.  returns
+ *   FALSE if the text doesn't start with an http or https scheme.
+ */
+gboolean
+ee_playlist_insert (EEPlaylist *playlist, const gchar *text, gssize len, gint position)
+{
+    EEUrl *url;
+    gsize n;
+
+    if (len < 0)
+        len = strlen (text);
+    /* a URL can't contain unescaped whitespace, so that ends it */
+    for (n = 0; n < (gsize) len && !g_ascii_isspace (text[n]); n++)
+        ;
+    if (!has_http_scheme (text, n))
+        return FALSE;
+    url = alloc_url (playlist);
+    url->text = g_string_chunk_insert_len (playlist->strings, text, n);
+    parse_attributes (playlist, url, text + n, len - n);
+    add_key (playlist, url, text, n);
+    insert_url (playlist, url, position);
+    return TRUE;
+}
+
+/*
+ * ee_playlist_insert_uri: insert the already parsed uri at
+ *   position.  returns FALSE if uri isn't an http or https URL.
+ */
+gboolean
+ee_playlist_insert_uri (EEPlaylist *playlist, SoupURI *uri, gint position)
+{
+    EEUrl *url;
+    gchar *text;
+
+    text = format_uri (uri);
+    if (text == NULL)
+        return FALSE;
+    url = alloc_url (playlist);
+    url->text = g_string_chunk_insert (playlist->strings, text);
+    fill_url (playlist, url, uri);
+    add_key (playlist, url, text, strlen (text));
+    g_free (text);
+    insert_url (playlist, url, position);
+    return TRUE;
+}
+
+/*
+ * ee_playlist_remove: remove and free the URL at index.  cursors pointing
+ *   after index are moved along with their entries, and a cursor pointing
+ *   at the removed entry is moved to the entry before it (or -1), so that
+ *   the next entry is the one which took its place.  an entry cursor
+ *   pointing at the removed entry is set to -1.  returns FALSE if index is
+ *   out of range.
+ */
+gboolean
+ee_playlist_remove (EEPlaylist *playlist, guint index)
+{
+    GSList *item;
+    gint *cursor;
+    EEUrl *url;
+
+    if (index >= playlist->entries->len)
+        return FALSE;
+    url = (EEUrl *) g_ptr_array_remove_index (playlist->entries, index);
+    remove_key (playlist, url);
+    free_url (playlist, url);
+    renumber (playlist, index);
+
+    for (item = playlist->cursors; item; item = g_slist_next (item)) {
+        cursor = (gint *) item->data;
+        if (*cursor >= (gint) index)
+            (*cursor)--;
+    }
+    for (item = playlist->entry_cursors; item; item = g_slist_next (item)) {
+        cursor = (gint *) item->data;
+        if (*cursor == (gint) index)
+            *cursor = -1;
+        else if (*cursor > (gint) index)
+            (*cursor)--;
+    }
+    return TRUE;
+}
+
+/*
+ * ee_playlist_set_attributes: replace the attributes of the entry at index
+ *   with those in text of length len (or -1 if text is nul-terminated).
+ *   returns FALSE if index is out of range.
+ */
+gboolean
+ee_playlist_set_attributes (EEPlaylist *playlist, guint index, const gchar *text, gssize len)
+{
+    EEUrl *url;
+
+    url = ee_playlist_get (playlist, index);
+    if (url == NULL)
+        return FALSE;
+    if (len < 0)
+        len = strlen (text);
+    url->dwell = 0;
+    url->refresh = 0;
+    url->timeout = 0;
+    url->profile = NULL;
+    parse_attributes (playlist, url, text, len);
+    return TRUE;
+}
+
+/*
+ * ee_playlist_find: returns the index of an entry which is the same URL as
+ *   text (of length len, or -1 if text is nul-terminated), or -1 if there
+ *   is no such entry.  URLs are compared after normalizing them with
+ *   ee_url_normalize.  if the URL appears more than once, then the most
+ *   recently inserted entry is returned.
+ */
+gint
+ee_playlist_find (EEPlaylist *playlist, const gchar *text, gssize len)
+{
+    EEUrl *url;
+    gchar *key;
+
+    if (len < 0)
+        len = strlen (text);
+    key = ee_url_normalize (text, len);
+    url = (EEUrl *) g_hash_table_lookup (playlist->keys, key);
+    g_free (key);
+    return url ? (gint) url->index : -1;
+}
+
+/*
+ * ee_playlist_find_uri: like ee_playlist_find, but for a parsed URL.
+ */
+gint
+ee_playlist_find_uri (EEPlaylist *playlist, SoupURI *uri)
+{
+    gchar *text;
+    gint index;
+
+    text = format_uri (uri);
+    if (text == NULL)
+        return -1;
+    index = ee_playlist_find (playlist, text, -1);
+    g_free (text);
+    return index;
+}
+
+/*
+ * ee_playlist_next: returns the index after index, wrapping around to the
+ *   start of the playlist.  returns -1 if the playlist is empty.
+ */
+gint
+ee_playlist_next (EEPlaylist *playlist, gint index)
+{
+    if (playlist->entries->len == 0)
+        return -1;
+    if (index < 0 || (guint) index + 1 >= playlist->entries->len)
+        return 0;
+    return index + 1;
+}
+
+/*
+ * ee_playlist_previous: returns the index before index, wrapping around to
+ *   the end of the playlist.  returns -1 if the playlist is empty.
+ */
+gint
+ee_playlist_previous (EEPlaylist *playlist, gint index)
+{
+    if (playlist->entries->len == 0)
+        return -1;
+    if (index <= 0 || (guint) index > playlist->entries->len)
+        return (gint) playlist->entries->len - 1;
+    return index - 1;
+}
+
+/*
+ * ee_playlist_add_cursor: register cursor with the playlist, so that it
+ *   keeps pointing at the same entry when entries are inserted or removed
+ *   before it.  a cursor of -1 doesn't point at any entry.
+ */
+void
+ee_playlist_add_cursor (EEPlaylist *playlist, gint *cursor)
+{
+    playlist->cursors = g_slist_prepend (playlist->cursors, cursor);
+}
+
+/*
+ * ee_playlist_add_entry_cursor: register cursor with the playlist, like
+ *   ee_playlist_add_cursor, except that the cursor is set to -1 when its
+ *   entry is removed, for state which belongs to that entry alone.
+ */
+void
+ee_playlist_add_entry_cursor (EEPlaylist *playlist, gint *cursor)
+{
+    playlist->entry_cursors = g_slist_prepend (playlist->entry_cursors, cursor);
+}
+
+/*
+ * ee_playlist_remove_cursor: stop tracking cursor.
+ */
+void
+ee_playlist_remove_cursor (EEPlaylist *playlist, gint *cursor)
+{
+    playlist->cursors = g_slist_remove (playlist->cursors, cursor);
+    playlist->entry_cursors = g_slist_remove (playlist->entry_cursors, cursor);
+}
+
+/*
+ * ee_playlist_compact: copy the strings of the remaining entries into a
+ *   new arena and free the old one, reclaiming the strings of removed
+ *   entries.  this walks every entry, so it is meant to be done when the
+ *   whole playlist is being written out anyway.  hosts and credentials are
+ *   interned, so they are few enough to be left alone.
+ */
+void
+ee_playlist_compact (EEPlaylist *playlist)
+{
+    GStringChunk *strings;
+    const gchar *text, *key;
+    EEUrl *url;
+    guint i;
+
+    if (playlist->garbage == 0)
+        return;
+    g_debug ("compacting playlist, reclaiming %" G_GSIZE_FORMAT " bytes", playlist->garbage);
+    strings = g_string_chunk_new (64 * 1024);
+    for (i = 0; i < playlist->entries->len; i++) {
+        url = (EEUrl *) g_ptr_array_index (playlist->entries, i);
+        text = g_string_chunk_insert (strings, url->text);
+        key = url->key == url->text ? text : g_string_chunk_insert (strings, url->key);
+        if (url->display == url->text)
+            url->display = text;
+        else if (url->display == url->key)
+            url->display = key;
+        else if (url->display)
+            url->display = g_string_chunk_insert (strings, url->display);
+        /* the index keys on the newest entry of each chain, and the old
+         * key is still readable, so the hash lookup works before replacing
+         * it */
+        if (g_hash_table_lookup (playlist->keys, url->key) == url)
+            g_hash_table_replace (playlist->keys, (gpointer) key, url);
+        url->text = text;
+        url->key = key;
+    }
+    g_string_chunk_free (playlist->strings);
+    playlist->strings = strings;
+    playlist->garbage = 0;
+}
+
+/*
+ * ee_playlist_free: free the playlist and all of its URLs.
+ */
+void
+ee_playlist_free (EEPlaylist *playlist)
+{
+    guint i;
+
+    g_ptr_array_free (playlist->entries, TRUE);
+    g_hash_table_destroy (playlist->keys);
+    for (i = 0; i < playlist->blocks->len; i++)
+        g_free (g_ptr_array_index (playlist->blocks, i));
+    g_ptr_array_free (playlist->blocks, TRUE);
+    g_string_chunk_free (playlist->strings);
+    g_string_chunk_free (playlist->atoms);
+    g_slist_free (playlist->cursors);
+    g_slist_free (playlist->entry_cursors);
+    g_free (playlist);
+}
+
+/*
+ * ee_url_normalize: returns the URL text of length len (or -1 if text is
+ *   nul-terminated) in a canonical form for comparing URLs, without
+ *   parsing it into a SoupURI.  the scheme and host are lowercased, the
+ *   credentials and default port are dropped, and an empty path becomes
+ *   "/".  the path, query and fragment are compared as-is.
+ */
+gchar *
+ee_url_normalize (const gchar *text, gssize len)
+{
+    const gchar *end, *p, *authority, *authority_end, *host, *host_end, *port;
+    GString *key;
+    gboolean https = FALSE;
+
+    if (len < 0)
+        len = strlen (text);
+    end = text + len;
+    key = g_string_sized_new (len);
+
+    /* lowercase the scheme */
+    for (p = text; p < end && *p != ':'; p++)
+        g_string_append_c (key, g_ascii_tolower (*p));
+    if (!strcmp (key->str, "https"))
+        https = TRUE;
+    if (end - p < 3 || strncmp (p, "://", 3) != 0) {
+        /* not something we can normalize, so compare it as-is */
+        g_string_truncate (key, 0);
+        g_string_append_len (key, text, len);
+        return g_string_free (key, FALSE);
+    }
+    g_string_append (key, "://");
+    authority = p + 3;
+
+    /* find the end of the authority, and skip the credentials */
+    for (authority_end = authority; authority_end < end; authority_end++)
+        if (*authority_end == '/' || *authority_end == '?' || *authority_end == '#')
+            break;
+    host = authority;
+    for (p = authority; p < authority_end; p++)
+        if (*p == '@')
+            host = p + 1;
+
+    /* find the port, skipping over IPv6 literals */
+    port = NULL;
+    host_end = authority_end;
+    p = host;
+    if (p < authority_end && *p == '[')
+        while (p < authority_end && *p != ']')
+            p++;
+    for (; p < authority_end; p++)
+        if (*p == ':') {
+            host_end = p;
+            port = p + 1;
+            break;
+        }
+
+    /* lowercase the host */
+    for (p = host; p < host_end; p++)
+        g_string_append_c (key, g_ascii_tolower (*p));
+
+    /* append the port, unless it is empty or the default for the scheme */
+    if (port && port < authority_end) {
+        len = authority_end - port;
+        if (!(len == 2 && !https && !strncmp (port, "80", 2)) &&
+            !(len == 3 && https && !strncmp (port, "443", 3))) {
+            g_string_append_c (key, ':');
+            g_string_append_len (key, port, len);
+        }
+    }
+
+    /* append the path, query and fragment */
+    if (authority_end == end || *authority_end != '/')
+        g_string_append_c (key, '/');
+    g_string_append_len (key, authority_end, end - authority_end);
+    return g_string_free (key, FALSE);
+}
+
+/*
+ * ee_url_format_attributes: format the attributes of url which differ from
+ *   the defaults into buf, which holds size bytes, as they are written
+ *   after the URL in the urls file.  each attribute is preceded by a
+ *   space.  returns the length of the attributes, which is 0 if they all
+ *   have their default values.
+ */
+gsize
+ee_url_format_attributes (EEUrl *url, gchar *buf, gsize size)
+{
+    gsize len = 0;
+
+    buf[0] = '\0';
+    if (url->dwell)
+        len += g_snprintf (buf + len, size - len, " dwell=%u", url->dwell);
+    if (url->refresh && len < size)
+        len += g_snprintf (buf + len, size - len, " refresh=%u", url->refresh);
+    if (url->timeout && len < size)
+        len += g_snprintf (buf + len, size - len, " timeout=%u", url->timeout);
+    if (url->profile && len < size)
+        len += g_snprintf (buf + len, size - len, " profile=%s", url->profile);
+    return MIN (len, size - 1);
+}
@@ -0,0 +1,69 @@
+#ifndef EE_PLAYLIST_H
+#define EE_PLAYLIST_H
+
+#include <glib.h>
+#include <libsoup/soup.h>
+
+/* enough room for all of the attributes formatted by ee_url_format_attributes */
+#define EE_URL_ATTRIBUTES_MAX 128
+
+/* the longest profile name accepted in a profile= attribute */
+#define EE_URL_PROFILE_MAX 48
+
+typedef struct _EEUrl EEUrl;
+
+struct _EEUrl {
+    const gchar *text;
+    const gchar *key;
+    const gchar *display;
+    const gchar *scheme;
+    const gchar *host;
+    const gchar *user;
+    const gchar *password;
+    const gchar *profile;
+    EEUrl *next_dup;
+    guint index;
+    guint dwell;
+    guint refresh;
+    guint timeout;
+    guint port : 16;
+    guint parsed : 1;
+    guint invalid : 1;
+};
+
+typedef struct {
+    GPtrArray *entries;
+    GSList *cursors;
+    GSList *entry_cursors;
+    GHashTable *keys;
+    GStringChunk *strings;
+    gsize garbage;
+    GStringChunk *atoms;
+    GPtrArray *blocks;
+    EEUrl *block;
+    guint block_used;
+    EEUrl *free_urls;
+} EEPlaylist;
+
+EEPlaylist *ee_playlist_new (void);
+guint ee_playlist_length (EEPlaylist *playlist);
+EEUrl *ee_playlist_get (EEPlaylist *playlist, gint index);
+EEUrl *ee_playlist_get_parsed (EEPlaylist *playlist, gint index);
+gboolean ee_playlist_insert (EEPlaylist *playlist, const gchar *text, gssize len, gint position);
+gboolean ee_playlist_insert_uri (EEPlaylist *playlist, SoupURI *uri, gint position);
+gboolean ee_playlist_remove (EEPlaylist *playlist, guint index);
+gboolean ee_playlist_set_attributes (EEPlaylist *playlist, guint index, const gchar *text, gssize len);
+gint ee_playlist_find (EEPlaylist *playlist, const gchar *text, gssize len);
+gint ee_playlist_find_uri (EEPlaylist *playlist, SoupURI *uri);
+gint ee_playlist_next (EEPlaylist *playlist, gint index);
+gint ee_playlist_previous (EEPlaylist *playlist, gint index);
+void ee_playlist_add_cursor (EEPlaylist *playlist, gint *cursor);
+void ee_playlist_add_entry_cursor (EEPlaylist *playlist, gint *cursor);
+void ee_playlist_remove_cursor (EEPlaylist *playlist, gint *cursor);
+void ee_playlist_compact (EEPlaylist *playlist);
+void ee_playlist_free (EEPlaylist *playlist);
+
+gchar *ee_url_normalize (const gchar *text, gssize len);
+gsize ee_url_format_attributes (EEUrl *url, gchar *buf, gsize size);
+
+#endif
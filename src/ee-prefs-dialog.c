@@ -2,6 +2,7 @@
 #include <gtk/gtk.h>
 #include <ee-main-window.h>
 #include <ee-settings.h>
+#include <ee-trace.h>
 
 void
 on_cycle_time_changed (GtkSpinButton *      button,
@@ -9,7 +10,7 @@ on_cycle_time_changed (GtkSpinButton *      button,
 {
     mainwin->settings->cycle_time =
         (gint) gtk_spin_button_get_value (GTK_SPIN_BUTTON (button));
-    ee_settings_save (mainwin->settings);
+    ee_settings_changed (mainwin->settings, EE_SETTINGS_CONFIG);
 }
 
 void
@@ -18,7 +19,7 @@ on_start_fullscreen (GtkToggleButton *      button,
 {
     mainwin->settings->start_fullscreen = 
         gtk_toggle_button_get_active (button);
-    ee_settings_save (mainwin->settings);
+    ee_settings_changed (mainwin->settings, EE_SETTINGS_CONFIG);
 }
 
 void
@@ -26,10 +27,9 @@ on_disable_plugins (GtkToggleButton *       button,
                     EEMainWindow *          mainwin)
 {
     gboolean disable_plugins = gtk_toggle_button_get_active (button);
-    WebKitWebSettings *websettings = webkit_web_view_get_settings (mainwin->webview);
     mainwin->settings->disable_plugins = disable_plugins;
-    g_object_set (websettings, "enable-plugins", !disable_plugins, NULL);
-    ee_settings_save (mainwin->settings);
+    ee_main_window_set_web_setting (mainwin, "enable-plugins", !disable_plugins);
+    ee_settings_changed (mainwin->settings, EE_SETTINGS_CONFIG);
 }
 
 void
@@ -37,10 +37,9 @@ on_disable_scripts (GtkToggleButton *       button,
                     EEMainWindow *          mainwin)
 {
     gboolean disable_scripts = gtk_toggle_button_get_active (button);
-    WebKitWebSettings *websettings = webkit_web_view_get_settings (mainwin->webview);
     mainwin->settings->disable_scripts = disable_scripts;
-    g_object_set (websettings, "enable-scripts", !disable_scripts, NULL);
-    ee_settings_save (mainwin->settings);
+    ee_main_window_set_web_setting (mainwin, "enable-scripts", !disable_scripts);
+    ee_settings_changed (mainwin->settings, EE_SETTINGS_CONFIG);
 }
 
 /*
@@ -114,6 +113,8 @@ ee_prefs_dialog_run (EEMainWindow *mainwin)
 
     /* run the dialog */
     gtk_widget_show_all (dialog);
+    EE_TRACE_BEGIN ("dialog", "preferences", NULL);
     gtk_dialog_run (GTK_DIALOG (dialog));
+    EE_TRACE_END ("dialog", "preferences");
     gtk_widget_destroy (dialog);
 }
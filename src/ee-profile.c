@@ -0,0 +1,127 @@
+#include <string.h>
+#include <glib.h>
+#include <webkit/webkit.h>
+#include <ee-profile.h>
+
+/*
+ * get_flag: returns the boolean key of group, or -1 if it isn't set or
+ *   can't be parsed.
+ */
+static gint
+get_flag (GKeyFile *config, const gchar *group, const gchar *key)
+{
+    GError *error = NULL;
+    gboolean value;
+
+    if (!g_key_file_has_key (config, group, key, NULL))
+        return -1;
+    value = g_key_file_get_boolean (config, group, key, &error);
+    if (error) {
+        g_warning ("configuration error: failed to parse %s::%s", group, key);
+        g_error_free (error);
+        return -1;
+    }
+    return value ? 1 : 0;
+}
+
+/*
+ * ee_profile_new_from_keyfile: load the render profile called name from
+ *   group of config.  the keys are:
+ *
+ *   scripts=BOOL       whether pages may run scripts
+ *   plugins=BOOL       whether pages may load plugins
+ *   images=BOOL        whether images are loaded
+ *   zoom=FACTOR        the zoom level pages are shown at
+ *   block=GLOB;...     resources which are never requested, matched
+ *                      against the whole URL, such as http*://ads.example.com*
+ *
+ *   keys which aren't set leave the preferences alone.
+ */
+EEProfile *
+ee_profile_new_from_keyfile (GKeyFile *config, const gchar *group, const gchar *name)
+{
+    EEProfile *profile;
+    GError *error = NULL;
+    gchar **patterns;
+    gsize n_patterns, i;
+    gdouble zoom;
+
+    profile = g_new0 (EEProfile, 1);
+    profile->name = g_strdup (name);
+    profile->enable_scripts = get_flag (config, group, "scripts");
+    profile->enable_plugins = get_flag (config, group, "plugins");
+    profile->auto_load_images = get_flag (config, group, "images");
+    profile->block = g_ptr_array_new_with_free_func ((GDestroyNotify) g_pattern_spec_free);
+
+    if (g_key_file_has_key (config, group, "zoom", NULL)) {
+        zoom = g_key_file_get_double (config, group, "zoom", &error);
+        if (error || zoom <= 0.0) {
+            g_warning ("configuration error: failed to parse %s::zoom", group);
+            if (error)
+                g_error_free (error);
+            error = NULL;
+        }
+        else
+            profile->zoom = zoom;
+    }
+
+    patterns = g_key_file_get_string_list (config, group, "block", &n_patterns, NULL);
+    for (i = 0; patterns && i < n_patterns; i++) {
+        g_strstrip (patterns[i]);
+        if (patterns[i][0] != '\0')
+            g_ptr_array_add (profile->block, g_pattern_spec_new (patterns[i]));
+    }
+    g_strfreev (patterns);
+
+    g_debug ("loaded profile %s: %u block patterns", name, profile->block->len);
+    return profile;
+}
+
+/*
+ * ee_profile_apply: set the preferences of profile on websettings.
+ *   preferences the profile doesn't set are left as they are.
+ */
+void
+ee_profile_apply (EEProfile *profile, WebKitWebSettings *websettings)
+{
+    g_assert (profile != NULL);
+    g_assert (websettings != NULL);
+
+    if (profile->enable_scripts >= 0)
+        g_object_set (websettings, "enable-scripts", profile->enable_scripts, NULL);
+    if (profile->enable_plugins >= 0)
+        g_object_set (websettings, "enable-plugins", profile->enable_plugins, NULL);
+    if (profile->auto_load_images >= 0)
+        g_object_set (websettings, "auto-load-images", profile->auto_load_images, NULL);
+}
+
+/*
+ * ee_profile_blocks: returns TRUE if requests for uri should be dropped.
+ */
+gboolean
+ee_profile_blocks (EEProfile *profile, const gchar *uri)
+{
+    gsize len;
+    guint i;
+
+    if (profile == NULL || profile->block->len == 0 || uri == NULL)
+        return FALSE;
+    len = strlen (uri);
+    for (i = 0; i < profile->block->len; i++) {
+        if (g_pattern_match (g_ptr_array_index (profile->block, i), len, uri, NULL))
+            return TRUE;
+    }
+    return FALSE;
+}
+
+/*
+ * ee_profile_free: free the profile.
+ */
+void
+ee_profile_free (EEProfile *profile)
+{
+    g_assert (profile != NULL);
+    g_ptr_array_free (profile->block, TRUE);
+    g_free (profile->name);
+    g_free (profile);
+}
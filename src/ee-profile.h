@@ -0,0 +1,24 @@
+#ifndef EE_PROFILE_H
+#define EE_PROFILE_H
+
+#include <glib.h>
+#include <webkit/webkit.h>
+
+/* prefix of the config file groups which define render profiles */
+#define EE_PROFILE_GROUP_PREFIX "profile "
+
+typedef struct {
+    gchar *name;
+    gint enable_scripts;
+    gint enable_plugins;
+    gint auto_load_images;
+    gdouble zoom;
+    GPtrArray *block;
+} EEProfile;
+
+EEProfile *ee_profile_new_from_keyfile (GKeyFile *config, const gchar *group, const gchar *name);
+void ee_profile_apply (EEProfile *profile, WebKitWebSettings *websettings);
+gboolean ee_profile_blocks (EEProfile *profile, const gchar *uri);
+void ee_profile_free (EEProfile *profile);
+
+#endif
@@ -0,0 +1,235 @@
+#include <glib.h>
+#include <ee-scheduler.h>
+
+/*
+ * get_time: returns the monotonic time in milliseconds.
+ */
+static gint64
+get_time (void)
+{
+    return g_get_monotonic_time () / 1000;
+}
+
+/*
+ * heap_get: returns the event at position in the heap.
+ */
+static EESchedulerEvent *
+heap_get (EEScheduler *scheduler, guint position)
+{
+    return (EESchedulerEvent *) g_ptr_array_index (scheduler->heap, position);
+}
+
+/*
+ * heap_set: store event at position in the heap.
+ */
+static void
+heap_set (EEScheduler *scheduler, guint position, EESchedulerEvent *event)
+{
+    scheduler->heap->pdata[position] = event;
+    event->position = position;
+}
+
+/*
+ * sift_up: move the event at position towards the root until its parent
+ *   is due no later than it is.
+ */
+static void
+sift_up (EEScheduler *scheduler, guint position)
+{
+    EESchedulerEvent *event = heap_get (scheduler, position);
+    EESchedulerEvent *parent;
+
+    while (position > 0) {
+        parent = heap_get (scheduler, (position - 1) / 2);
+        if (parent->deadline <= event->deadline)
+            break;
+        heap_set (scheduler, position, parent);
+        position = (position - 1) / 2;
+    }
+    heap_set (scheduler, position, event);
+}
+
+/*
+ * sift_down: move the event at position towards the leaves until both of
+ *   its children are due no earlier than it is.
+ */
+static void
+sift_down (EEScheduler *scheduler, guint position)
+{
+    EESchedulerEvent *event = heap_get (scheduler, position);
+    EESchedulerEvent *child;
+    guint len = scheduler->heap->len;
+    guint c;
+
+    while ((c = 2 * position + 1) < len) {
+        if (c + 1 < len && heap_get (scheduler, c + 1)->deadline < heap_get (scheduler, c)->deadline)
+            c++;
+        child = heap_get (scheduler, c);
+        if (event->deadline <= child->deadline)
+            break;
+        heap_set (scheduler, position, child);
+        position = c;
+    }
+    heap_set (scheduler, position, event);
+}
+
+/*
+ * heap_remove: remove the event from the heap, by moving the last event
+ *   into its place and restoring the heap order.
+ */
+static void
+heap_remove (EEScheduler *scheduler, EESchedulerEvent *event)
+{
+    EESchedulerEvent *last;
+    guint position = event->position;
+
+    last = (EESchedulerEvent *) g_ptr_array_remove_index (scheduler->heap, scheduler->heap->len - 1);
+    if (last == event)
+        return;
+    heap_set (scheduler, position, last);
+    if (position > 0 && heap_get (scheduler, (position - 1) / 2)->deadline > last->deadline)
+        sift_up (scheduler, position);
+    else
+        sift_down (scheduler, position);
+}
+
+static gboolean on_dispatch (EEScheduler *scheduler);
+
+/*
+ * arm: make sure the main loop wakes us up when the earliest event is due.
+ *   there is only ever one main loop source, however many events are
+ *   scheduled.
+ */
+static void
+arm (EEScheduler *scheduler)
+{
+    EESchedulerEvent *first;
+    gint64 now;
+
+    if (scheduler->heap->len == 0) {
+        if (scheduler->source_id > 0)
+            g_source_remove (scheduler->source_id);
+        scheduler->source_id = 0;
+        return;
+    }
+    first = heap_get (scheduler, 0);
+    if (scheduler->source_id > 0) {
+        if (scheduler->source_deadline == first->deadline)
+            return;
+        g_source_remove (scheduler->source_id);
+    }
+    now = get_time ();
+    scheduler->source_deadline = first->deadline;
+    scheduler->source_id = g_timeout_add (first->deadline > now ? first->deadline - now : 0,
+        (GSourceFunc) on_dispatch, scheduler);
+}
+
+/*
+ * on_dispatch: run every event which is due.  an event may add or remove
+ *   other events, so the heap is checked again after each one.
+ */
+static gboolean
+on_dispatch (EEScheduler *scheduler)
+{
+    EESchedulerEvent *event;
+    gint64 now = get_time ();
+
+    scheduler->source_id = 0;
+    while (scheduler->heap->len > 0) {
+        event = heap_get (scheduler, 0);
+        if (event->deadline > now)
+            break;
+        heap_remove (scheduler, event);
+        g_hash_table_steal (scheduler->events, GUINT_TO_POINTER (event->id));
+        if (scheduler->drift_func)
+            scheduler->drift_func (now - event->deadline, scheduler->drift_data);
+        event->func (event->data);
+        g_free (event);
+    }
+    arm (scheduler);
+    return FALSE;
+}
+
+/*
+ * ee_scheduler_new: create a scheduler, which runs one-shot events at
+ *   their deadlines from the main loop.  events are kept in a min-heap
+ *   ordered by deadline, so adding or removing an event takes O(log n) in
+ *   the number of scheduled events, and never depends on the size of the
+ *   playlist.
+ */
+EEScheduler *
+ee_scheduler_new (void)
+{
+    EEScheduler *scheduler;
+
+    scheduler = g_new0 (EEScheduler, 1);
+    scheduler->heap = g_ptr_array_new ();
+    scheduler->events = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
+    scheduler->next_id = 1;
+    return scheduler;
+}
+
+/*
+ * ee_scheduler_add: call func with data once, delay milliseconds from now.
+ *   returns the id of the event, which is never 0.
+ */
+guint
+ee_scheduler_add (EEScheduler *scheduler, guint delay, EESchedulerFunc func, gpointer data)
+{
+    EESchedulerEvent *event;
+
+    event = g_new0 (EESchedulerEvent, 1);
+    event->id = scheduler->next_id++;
+    if (scheduler->next_id == 0)
+        scheduler->next_id = 1;
+    event->deadline = get_time () + delay;
+    event->func = func;
+    event->data = data;
+    g_hash_table_insert (scheduler->events, GUINT_TO_POINTER (event->id), event);
+    g_ptr_array_add (scheduler->heap, event);
+    sift_up (scheduler, scheduler->heap->len - 1);
+    arm (scheduler);
+    return event->id;
+}
+
+/*
+ * ee_scheduler_remove: cancel the event with the specified id.  returns
+ *   FALSE if the event has already run or been removed.
+ */
+gboolean
+ee_scheduler_remove (EEScheduler *scheduler, guint id)
+{
+    EESchedulerEvent *event;
+
+    event = (EESchedulerEvent *) g_hash_table_lookup (scheduler->events, GUINT_TO_POINTER (id));
+    if (event == NULL)
+        return FALSE;
+    heap_remove (scheduler, event);
+    g_hash_table_remove (scheduler->events, GUINT_TO_POINTER (id));
+    arm (scheduler);
+    return TRUE;
+}
+
+/*
+ * ee_scheduler_set_drift_func: call func with how many milliseconds late
+ *   each event runs, or stop if func is NULL.
+ */
+void
+ee_scheduler_set_drift_func (EEScheduler *scheduler, EESchedulerDriftFunc func, gpointer data)
+{
+    scheduler->drift_func = func;
+    scheduler->drift_data = data;
+}
+
+/*
+ * ee_scheduler_free: cancel all events and free the scheduler.
+ */
+void
+ee_scheduler_free (EEScheduler *scheduler)
+{
+    if (scheduler->source_id > 0)
+        g_source_remove (scheduler->source_id);
+    g_ptr_array_free (scheduler->heap, TRUE);
+    g_hash_table_destroy (scheduler->events);
+    g_free (scheduler);
+}
@@ -0,0 +1,33 @@
+#ifndef EE_SCHEDULER_H
+#define EE_SCHEDULER_H
+
+#include <glib.h>
+
+typedef void (*EESchedulerFunc) (gpointer data);
+typedef void (*EESchedulerDriftFunc) (gint64 drift, gpointer data);
+
+typedef struct {
+    guint id;
+    guint position;
+    gint64 deadline;
+    EESchedulerFunc func;
+    gpointer data;
+} EESchedulerEvent;
+
+typedef struct {
+    GPtrArray *heap;
+    GHashTable *events;
+    guint next_id;
+    guint source_id;
+    gint64 source_deadline;
+    EESchedulerDriftFunc drift_func;
+    gpointer drift_data;
+} EEScheduler;
+
+EEScheduler *ee_scheduler_new (void);
+guint ee_scheduler_add (EEScheduler *scheduler, guint delay, EESchedulerFunc func, gpointer data);
+gboolean ee_scheduler_remove (EEScheduler *scheduler, guint id);
+void ee_scheduler_set_drift_func (EEScheduler *scheduler, EESchedulerDriftFunc func, gpointer data);
+void ee_scheduler_free (EEScheduler *scheduler);
+
+#endif
@@ -7,84 +7,104 @@
 #include <gtk/gtk.h>
 #include <libsoup/soup.h>
 #include <ee-settings.h>
+#include <ee-persist.h>
+#include <ee-profile.h>
+#include <ee-trace.h>
+
+/* how long to wait after a change before writing settings to disk, in ms */
+#define EE_SETTINGS_SAVE_DELAY 1000
+
+/* once the journal grows past this many bytes, it is folded into urls */
+#define EE_SETTINGS_JOURNAL_MAX (64 * 1024)
+
+/* the first line of the urls file and the journal */
+#define EE_SETTINGS_SERIAL_HEADER "# serial "
+
+/* values of main::duplicate-urls, indexed by the EE_DUPLICATES_* policy */
+static const gchar *duplicate_policies[] = { "reject", "move-to-front", "allow", NULL };
 
 /*
- * write_config_file: write configuration to config file.
+ * write_config_file: queue configuration to be written to config file.
  */
 static gboolean
 write_config_file (EESettings *settings)
 {
-    GKeyFile *config;
     gchar *config_file = NULL;
-    GError *error = NULL;
-    GIOChannel *ioc;
-    GIOStatus status;
-    gchar *data, *curr;
+    gchar *data;
     gsize len;
-    gsize nwritten;
- 
-    /* load configuration file */
-    config = g_key_file_new ();
-    config_file = g_build_filename (settings->home, "config", NULL);
-    g_key_file_load_from_file (config, config_file, 0, &error);
-    if (error) {
-        if (error->domain == G_FILE_ERROR && error->code == G_FILE_ERROR_NOENT) {
-            g_error_free (error);
-            error = NULL;
-        }
-        else {
-            g_critical ("failed to open %s: %s", config_file, error->message);
-            g_error_free (error);
-            g_key_file_free (config);
-            g_free (config_file);
-            return FALSE;
-        }
-    }
+
+    EE_TRACE_BEGIN ("settings", "write_config_file", NULL);
+    /* settings->keyfile holds the contents of the config file as it was
+     * loaded, so keys we don't know about are preserved */
+    if (settings->keyfile == NULL)
+        settings->keyfile = g_key_file_new ();
 
     /* write settings to config */
-    g_key_file_set_integer (config, "main", "cycle-time", settings->cycle_time);
-    g_key_file_set_boolean (config, "main", "start-fullscreen", settings->start_fullscreen);
-    g_key_file_set_boolean (config, "main", "disable-plugins", settings->disable_plugins);
-    g_key_file_set_boolean (config, "main", "disable-scripts", settings->disable_scripts);
-    g_key_file_set_boolean (config, "main", "small-toolbar", settings->small_toolbar);
-
-    /* write config to file */
-    ioc = g_io_channel_new_file (config_file, "w", &error);
-    if (error) {
-        g_critical ("failed to open %s for writing: %s", config_file, error->message);
-        g_error_free (error);
-        g_key_file_free (config);
-        g_free (config_file);
-        if (ioc)
-            g_io_channel_unref (ioc);
-        return FALSE;
-    }
-    curr = data = g_key_file_to_data (config, &len, &error);
-    again:
-    status = g_io_channel_write_chars (ioc, curr, (gssize) len, &nwritten, &error);
-    curr += nwritten;
-    len -= nwritten;
-    if (status == G_IO_STATUS_AGAIN)
-        goto again;
-    if (len > 0)
-        goto again;
-    g_free (data);
-    if (status == G_IO_STATUS_ERROR) {
-        g_critical ("error writing configuration to %s: %s", config_file, error->message);
-        g_error_free (error);
-        g_free (config_file);
-        g_io_channel_unref (ioc);
-        return FALSE;
-    }
-    else
-        g_debug ("wrote configuration to %s", config_file);
+    g_key_file_set_integer (settings->keyfile, "main", "cycle-time", settings->cycle_time);
+    g_key_file_set_integer (settings->keyfile, "main", "preload-time", settings->preload_time);
+    g_key_file_set_integer (settings->keyfile, "main", "load-timeout", settings->load_timeout);
+    g_key_file_set_integer (settings->keyfile, "main", "pool-size", settings->pool_size);
+    g_key_file_set_integer (settings->keyfile, "main", "memory-budget", settings->memory_budget);
+    g_key_file_set_integer (settings->keyfile, "main", "cache-size", settings->cache_size);
+    g_key_file_set_integer (settings->keyfile, "main", "load-log-size", settings->load_log_size);
+    g_key_file_set_integer (settings->keyfile, "main", "metrics-port", settings->metrics_port);
+    g_key_file_set_integer (settings->keyfile, "main", "snapshot-interval", settings->snapshot_interval);
+    g_key_file_set_integer (settings->keyfile, "main", "warmup-time", settings->warmup_time);
+    g_key_file_set_integer (settings->keyfile, "main", "max-connections", settings->max_connections);
+    g_key_file_set_integer (settings->keyfile, "main", "max-connections-per-host", settings->max_connections_per_host);
+    g_key_file_set_integer (settings->keyfile, "main", "idle-timeout", settings->idle_timeout);
+    g_key_file_set_integer (settings->keyfile, "main", "tile-rows", settings->tile_rows);
+    g_key_file_set_integer (settings->keyfile, "main", "tile-columns", settings->tile_columns);
+    g_key_file_set_integer (settings->keyfile, "main", "watchdog-interval", settings->watchdog_interval);
+    g_key_file_set_integer (settings->keyfile, "main", "stall-threshold", settings->stall_threshold);
+    g_key_file_set_boolean (settings->keyfile, "main", "refresh-on-show", settings->refresh_on_show);
+    g_key_file_set_boolean (settings->keyfile, "main", "start-fullscreen", settings->start_fullscreen);
+    g_key_file_set_boolean (settings->keyfile, "main", "disable-plugins", settings->disable_plugins);
+    g_key_file_set_boolean (settings->keyfile, "main", "disable-scripts", settings->disable_scripts);
+    g_key_file_set_boolean (settings->keyfile, "main", "small-toolbar", settings->small_toolbar);
+    g_key_file_set_boolean (settings->keyfile, "main", "snapshot-mode", settings->snapshot_mode);
+    g_key_file_set_boolean (settings->keyfile, "main", "multi-monitor", settings->multi_monitor);
+    g_key_file_set_boolean (settings->keyfile, "main", "aligned-cycle", settings->aligned_cycle);
+    g_key_file_set_boolean (settings->keyfile, "main", "stall-backtrace", settings->stall_backtrace);
+    g_key_file_set_string (settings->keyfile, "main", "duplicate-urls",
+        duplicate_policies[settings->duplicate_urls]);
 
-    g_key_file_free (config);
+    /* hand the config data to the persistence thread */
+    config_file = g_build_filename (settings->home, "config", NULL);
+    data = g_key_file_to_data (settings->keyfile, &len, NULL);
+    ee_persist_write (settings->persist, config_file, data, len);
+    g_debug ("queued configuration for %s", config_file);
     g_free (config_file);
-    g_io_channel_unref (ioc);
+    EE_TRACE_END ("settings", "write_config_file");
     return TRUE;
 }
 
+/*
+ * load_profiles: load the render profiles from the [profile NAME] groups
+ *   of config.  URLs refer to them by name with the profile= attribute.
+ */
+static void
+load_profiles (EESettings *settings, GKeyFile *config)
+{
+    gchar **groups;
+    const gchar *name;
+    gsize i;
+
+    groups = g_key_file_get_groups (config, NULL);
+    for (i = 0; groups[i] != NULL; i++) {
+        if (!g_str_has_prefix (groups[i], EE_PROFILE_GROUP_PREFIX))
+            continue;
+        name = groups[i] + strlen (EE_PROFILE_GROUP_PREFIX);
+        if (name[0] == '\0' || strlen (name) > EE_URL_PROFILE_MAX || strpbrk (name, " \t")) {
+            g_warning ("configuration error: invalid profile name in [%s]", groups[i]);
+            continue;
+        }
+        g_hash_table_replace (settings->profiles, g_strdup (name),
+            ee_profile_new_from_keyfile (config, groups[i], name));
+    }
+    g_strfreev (groups);
+}
+
 /*
  * read_config_file: load configuration from config.
  */
@@ -95,10 +115,33 @@ read_config_file (EESettings *settings)
     GKeyFile *config;
     GError *error = NULL;
     gint cycle_time;
+    gint preload_time;
+    gint load_timeout;
+    gint pool_size;
+    gint memory_budget;
+    gint cache_size;
+    gint load_log_size;
+    gint metrics_port;
+    gint snapshot_interval;
+    gint warmup_time;
+    gint max_connections;
+    gint max_connections_per_host;
+    gint idle_timeout;
+    gint tile_rows;
+    gint tile_columns;
+    gint watchdog_interval;
+    gint stall_threshold;
+    gboolean refresh_on_show;
     gboolean start_fullscreen;
     gboolean disable_plugins;
     gboolean disable_scripts;
     gboolean small_toolbar;
+    gboolean snapshot_mode;
+    gboolean multi_monitor;
+    gboolean aligned_cycle;
+    gboolean stall_backtrace;
+    gchar *duplicate_urls;
+    gint i;
 
     config_file = g_build_filename (settings->home, "config", NULL);
     if (!g_file_test (config_file, G_FILE_TEST_IS_REGULAR))
@@ -106,7 +149,7 @@ read_config_file (EESettings *settings)
 
     /* load configuration file */
     config = g_key_file_new ();
-    g_key_file_load_from_file (config, config_file, 0, &error);
+    g_key_file_load_from_file (config, config_file, G_KEY_FILE_KEEP_COMMENTS, &error);
     if (error) {
         g_critical ("failed to open %s: %s", config_file, error->message);
         g_error_free (error);
@@ -139,6 +182,199 @@ read_config_file (EESettings *settings)
     else
         settings->cycle_time = cycle_time;
 
+    /* load preload-time parameter */
+    preload_time = g_key_file_get_integer (config, "main", "preload-time", &error);
+    if (error) {
+        if (error->code == G_KEY_FILE_ERROR_INVALID_VALUE)
+            g_warning ("configuration error: failed to parse main::preload-time");
+        g_error_free (error);
+        error = NULL;
+    }
+    else
+        settings->preload_time = preload_time;
+
+    /* load load-timeout parameter */
+    load_timeout = g_key_file_get_integer (config, "main", "load-timeout", &error);
+    if (error) {
+        if (error->code == G_KEY_FILE_ERROR_INVALID_VALUE)
+            g_warning ("configuration error: failed to parse main::load-timeout");
+        g_error_free (error);
+        error = NULL;
+    }
+    else
+        settings->load_timeout = load_timeout;
+
+    /* load pool-size parameter */
+    pool_size = g_key_file_get_integer (config, "main", "pool-size", &error);
+    if (error) {
+        if (error->code == G_KEY_FILE_ERROR_INVALID_VALUE)
+            g_warning ("configuration error: failed to parse main::pool-size");
+        g_error_free (error);
+        error = NULL;
+    }
+    else
+        settings->pool_size = pool_size;
+
+    /* load memory-budget parameter */
+    memory_budget = g_key_file_get_integer (config, "main", "memory-budget", &error);
+    if (error) {
+        if (error->code == G_KEY_FILE_ERROR_INVALID_VALUE)
+            g_warning ("configuration error: failed to parse main::memory-budget");
+        g_error_free (error);
+        error = NULL;
+    }
+    else
+        settings->memory_budget = memory_budget;
+
+    /* load cache-size parameter */
+    cache_size = g_key_file_get_integer (config, "main", "cache-size", &error);
+    if (error) {
+        if (error->code == G_KEY_FILE_ERROR_INVALID_VALUE)
+            g_warning ("configuration error: failed to parse main::cache-size");
+        g_error_free (error);
+        error = NULL;
+    }
+    else
+        settings->cache_size = cache_size;
+
+    /* load load-log-size parameter */
+    load_log_size = g_key_file_get_integer (config, "main", "load-log-size", &error);
+    if (error) {
+        if (error->code == G_KEY_FILE_ERROR_INVALID_VALUE)
+            g_warning ("configuration error: failed to parse main::load-log-size");
+        g_error_free (error);
+        error = NULL;
+    }
+    else
+        settings->load_log_size = load_log_size;
+
+    /* load metrics-port parameter */
+    metrics_port = g_key_file_get_integer (config, "main", "metrics-port", &error);
+    if (error) {
+        if (error->code == G_KEY_FILE_ERROR_INVALID_VALUE)
+            g_warning ("configuration error: failed to parse main::metrics-port");
+        g_error_free (error);
+        error = NULL;
+    }
+    else if (metrics_port < 0 || metrics_port > 65535)
+        g_warning ("configuration error: main::metrics-port is out of range");
+    else
+        settings->metrics_port = metrics_port;
+
+    /* load snapshot-interval parameter */
+    snapshot_interval = g_key_file_get_integer (config, "main", "snapshot-interval", &error);
+    if (error) {
+        if (error->code == G_KEY_FILE_ERROR_INVALID_VALUE)
+            g_warning ("configuration error: failed to parse main::snapshot-interval");
+        g_error_free (error);
+        error = NULL;
+    }
+    else
+        settings->snapshot_interval = snapshot_interval;
+
+    /* load warmup-time parameter */
+    warmup_time = g_key_file_get_integer (config, "main", "warmup-time", &error);
+    if (error) {
+        if (error->code == G_KEY_FILE_ERROR_INVALID_VALUE)
+            g_warning ("configuration error: failed to parse main::warmup-time");
+        g_error_free (error);
+        error = NULL;
+    }
+    else
+        settings->warmup_time = warmup_time;
+
+    /* load max-connections parameter */
+    max_connections = g_key_file_get_integer (config, "main", "max-connections", &error);
+    if (error) {
+        if (error->code == G_KEY_FILE_ERROR_INVALID_VALUE)
+            g_warning ("configuration error: failed to parse main::max-connections");
+        g_error_free (error);
+        error = NULL;
+    }
+    else
+        settings->max_connections = max_connections;
+
+    /* load max-connections-per-host parameter */
+    max_connections_per_host = g_key_file_get_integer (config, "main", "max-connections-per-host", &error);
+    if (error) {
+        if (error->code == G_KEY_FILE_ERROR_INVALID_VALUE)
+            g_warning ("configuration error: failed to parse main::max-connections-per-host");
+        g_error_free (error);
+        error = NULL;
+    }
+    else
+        settings->max_connections_per_host = max_connections_per_host;
+
+    /* load idle-timeout parameter */
+    idle_timeout = g_key_file_get_integer (config, "main", "idle-timeout", &error);
+    if (error) {
+        if (error->code == G_KEY_FILE_ERROR_INVALID_VALUE)
+            g_warning ("configuration error: failed to parse main::idle-timeout");
+        g_error_free (error);
+        error = NULL;
+    }
+    else
+        settings->idle_timeout = idle_timeout;
+
+    /* load tile-rows parameter */
+    tile_rows = g_key_file_get_integer (config, "main", "tile-rows", &error);
+    if (error) {
+        if (error->code == G_KEY_FILE_ERROR_INVALID_VALUE)
+            g_warning ("configuration error: failed to parse main::tile-rows");
+        g_error_free (error);
+        error = NULL;
+    }
+    else if (tile_rows < 1)
+        g_warning ("configuration error: main::tile-rows is out of range");
+    else
+        settings->tile_rows = tile_rows;
+
+    /* load tile-columns parameter */
+    tile_columns = g_key_file_get_integer (config, "main", "tile-columns", &error);
+    if (error) {
+        if (error->code == G_KEY_FILE_ERROR_INVALID_VALUE)
+            g_warning ("configuration error: failed to parse main::tile-columns");
+        g_error_free (error);
+        error = NULL;
+    }
+    else if (tile_columns < 1)
+        g_warning ("configuration error: main::tile-columns is out of range");
+    else
+        settings->tile_columns = tile_columns;
+
+    /* load watchdog-interval parameter */
+    watchdog_interval = g_key_file_get_integer (config, "main", "watchdog-interval", &error);
+    if (error) {
+        if (error->code == G_KEY_FILE_ERROR_INVALID_VALUE)
+            g_warning ("configuration error: failed to parse main::watchdog-interval");
+        g_error_free (error);
+        error = NULL;
+    }
+    else
+        settings->watchdog_interval = watchdog_interval;
+
+    /* load stall-threshold parameter */
+    stall_threshold = g_key_file_get_integer (config, "main", "stall-threshold", &error);
+    if (error) {
+        if (error->code == G_KEY_FILE_ERROR_INVALID_VALUE)
+            g_warning ("configuration error: failed to parse main::stall-threshold");
+        g_error_free (error);
+        error = NULL;
+    }
+    else
+        settings->stall_threshold = stall_threshold;
+
+    /* load refresh-on-show parameter */
+    refresh_on_show = g_key_file_get_boolean (config, "main", "refresh-on-show", &error);
+    if (error) {
+        if (error->code == G_KEY_FILE_ERROR_INVALID_VALUE)
+            g_warning ("configuration error: failed to parse main::refresh-on-show");
+        g_error_free (error);
+        error = NULL;
+    }
+    else
+        settings->refresh_on_show = refresh_on_show;
+
     /* load disable-plugins parameter */
     disable_plugins = g_key_file_get_boolean (config, "main", "disable-plugins", &error);
     if (error) {
@@ -172,96 +408,181 @@ read_config_file (EESettings *settings)
     else
         settings->small_toolbar = small_toolbar;
 
-    g_key_file_free (config);
+    /* load snapshot-mode parameter */
+    snapshot_mode = g_key_file_get_boolean (config, "main", "snapshot-mode", &error);
+    if (error) {
+        if (error->code == G_KEY_FILE_ERROR_INVALID_VALUE)
+            g_warning ("configuration error: failed to parse main::snapshot-mode");
+        g_error_free (error);
+        error = NULL;
+    }
+    else
+        settings->snapshot_mode = snapshot_mode;
+
+    /* load multi-monitor parameter */
+    multi_monitor = g_key_file_get_boolean (config, "main", "multi-monitor", &error);
+    if (error) {
+        if (error->code == G_KEY_FILE_ERROR_INVALID_VALUE)
+            g_warning ("configuration error: failed to parse main::multi-monitor");
+        g_error_free (error);
+        error = NULL;
+    }
+    else
+        settings->multi_monitor = multi_monitor;
+
+    /* load aligned-cycle parameter */
+    aligned_cycle = g_key_file_get_boolean (config, "main", "aligned-cycle", &error);
+    if (error) {
+        if (error->code == G_KEY_FILE_ERROR_INVALID_VALUE)
+            g_warning ("configuration error: failed to parse main::aligned-cycle");
+        g_error_free (error);
+        error = NULL;
+    }
+    else
+        settings->aligned_cycle = aligned_cycle;
+
+    /* load stall-backtrace parameter */
+    stall_backtrace = g_key_file_get_boolean (config, "main", "stall-backtrace", &error);
+    if (error) {
+        if (error->code == G_KEY_FILE_ERROR_INVALID_VALUE)
+            g_warning ("configuration error: failed to parse main::stall-backtrace");
+        g_error_free (error);
+        error = NULL;
+    }
+    else
+        settings->stall_backtrace = stall_backtrace;
+
+    /* load duplicate-urls parameter */
+    duplicate_urls = g_key_file_get_string (config, "main", "duplicate-urls", &error);
+    if (error) {
+        g_error_free (error);
+        error = NULL;
+    }
+    else {
+        for (i = 0; duplicate_policies[i] != NULL; i++)
+            if (!strcmp (g_strstrip (duplicate_urls), duplicate_policies[i]))
+                break;
+        if (duplicate_policies[i] != NULL)
+            settings->duplicate_urls = i;
+        else
+            g_warning ("configuration error: failed to parse main::duplicate-urls");
+        g_free (duplicate_urls);
+    }
+
+    /* load the render profiles */
+    load_profiles (settings, config);
+
+    /* keep the config around, so write_config_file can preserve unknown keys */
+    settings->keyfile = config;
     return TRUE;
 }
 
 /*
- * write_urls_file: write URLs to disk.
+ * write_urls_file: queue URLs to be written to disk.  the whole file is
+ *   serialized into a single buffer, which the persistence thread writes
+ *   and renames into place in one go.
  */
 static gboolean
 write_urls_file (EESettings *settings)
 {
     gchar *urls_file = NULL;
-    GIOChannel *ioc;
-    GError *error = NULL;
-    GIOStatus status;
-    GList *item;
-    SoupURI *uri;
-    GString *str;
-    gchar *data, *curr;
-    gssize len;
-    gsize nwritten;
-
-    /* try to open the urls file */
-    urls_file = g_build_filename (settings->home, "urls", NULL);
-    ioc = g_io_channel_new_file (urls_file, "w", &error);
-    if (error) {
-        g_critical ("failed to open %s for writing: %s", urls_file, error->message);
-        g_error_free (error);
-        g_free (urls_file);
-        if (ioc)
-            g_io_channel_unref (ioc);
-        return FALSE;
-    }
+    gchar *journal_file = NULL;
+    gchar *header;
+    EEUrl *url;
+    gchar attrs[EE_URL_ATTRIBUTES_MAX];
+    gchar *data, *p;
+    gsize len, n;
+    guint i;
 
-    /* loop reading each line of the file */
-    for (item = settings->urls; item; item = g_list_next (item)) {
-        uri = (SoupURI *) item->data;
-        str = g_string_new (NULL);
-        /* append the scheme */
-        if (uri->scheme == SOUP_URI_SCHEME_HTTP)
-            g_string_append_printf (str, "%s://", SOUP_URI_SCHEME_HTTP);
-        else if (uri->scheme == SOUP_URI_SCHEME_HTTPS)
-            g_string_append_printf (str, "%s://", SOUP_URI_SCHEME_HTTPS);
-        else {
-                g_string_free (str, TRUE);
-                continue;
-        }
-        /* append the username and password */
-        if (uri->user) {
-            str = g_string_append (str, uri->user);
-            if (uri->password)
-                g_string_append_printf (str, ":%s", uri->password);
-            str = g_string_append (str, "@");
-        }
-        /* append the host */
-        g_string_append (str, uri->host);
-        /* append the port */
-        if (uri->port != 80)
-            g_string_append_printf (str, ":%i", uri->port);
-        /* append the path */
-        g_string_append (str, uri->path);
-        if (uri->query)
-            g_string_append_printf (str, "?%s", uri->query);
-        if (uri->fragment)
-            g_string_append_printf (str, "#%s", uri->fragment);
-        g_string_append (str, "\n");
-        /* write out the string */
-        curr = data = g_string_free (str, FALSE);
-        len = (gssize) strlen (data);
-        /* write string to URLs file */
-        again:
-        status = g_io_channel_write_chars (ioc, curr, len, &nwritten, &error);
-        curr += nwritten;
-        len -= nwritten;
-        if (status == G_IO_STATUS_AGAIN)
-            goto again;
-        if (len > 0)
-            goto again;
-        g_free (data);
-        if (status == G_IO_STATUS_ERROR) {
-            g_critical ("error writing urls to %s: %s", urls_file, error->message);
-            g_error_free (error);
-            g_free (urls_file);
-            g_io_channel_unref (ioc);
-            return FALSE;
-        }
+    EE_TRACE_BEGIN ("settings", "write_urls_file", NULL);
+    /* each entry keeps the text it was loaded or inserted with, so there
+     * is no need to parse and reformat the URLs.  size the buffer first,
+     * so it is allocated exactly once. */
+    settings->urls_serial++;
+    header = g_strdup_printf (EE_SETTINGS_SERIAL_HEADER "%u\n", settings->urls_serial);
+    len = strlen (header);
+    for (i = 0; i < ee_playlist_length (settings->urls); i++) {
+        url = ee_playlist_get (settings->urls, i);
+        len += strlen (url->text) + ee_url_format_attributes (url, attrs, sizeof (attrs)) + 1;
+    }
+    data = p = g_malloc (len + 1);
+    p = g_stpcpy (p, header);
+    for (i = 0; i < ee_playlist_length (settings->urls); i++) {
+        url = ee_playlist_get (settings->urls, i);
+        n = strlen (url->text);
+        memcpy (p, url->text, n);
+        p += n;
+        n = ee_url_format_attributes (url, attrs, sizeof (attrs));
+        memcpy (p, attrs, n);
+        p += n;
+        *p++ = '\n';
     }
+    *p = '\0';
+    /* the whole playlist was just walked anyway, so reclaim the strings of
+     * entries removed since the last time */
+    ee_playlist_compact (settings->urls);
 
-    g_debug ("wrote URLs to %s", urls_file);
+    /* hand the buffer to the persistence thread */
+    urls_file = g_build_filename (settings->home, "urls", NULL);
+    ee_persist_write (settings->persist, urls_file, data, len);
+    g_debug ("queued URLs for %s", urls_file);
     g_free (urls_file);
-    g_io_channel_unref (ioc);
+
+    /* start a new journal with the same serial.  if we crash before the
+     * journal is replaced, the old journal no longer matches the urls file
+     * and is ignored, since its edits are already in the urls file. */
+    journal_file = g_build_filename (settings->home, "urls.journal", NULL);
+    settings->journal_size = strlen (header);
+    ee_persist_write (settings->persist, journal_file, header, settings->journal_size);
+    g_free (journal_file);
+    g_string_truncate (settings->journal, 0);
+    settings->compact_urls = FALSE;
+    EE_TRACE_END ("settings", "write_urls_file");
+    return TRUE;
+}
+
+/*
+ * append_journal: queue the pending playlist edits to be appended to the
+ *   journal, or fold them into the urls file if the journal is too large
+ *   or can't be appended to.
+ */
+static gboolean
+append_journal (EESettings *settings)
+{
+    gchar *journal_file;
+    gsize len;
+
+    if (settings->compact_urls ||
+        settings->journal_size + settings->journal->len > EE_SETTINGS_JOURNAL_MAX)
+        return write_urls_file (settings);
+    if (settings->journal->len == 0)
+        return TRUE;
+
+    journal_file = g_build_filename (settings->home, "urls.journal", NULL);
+    len = settings->journal->len;
+    ee_persist_append (settings->persist, journal_file,
+        g_strndup (settings->journal->str, len), len);
+    g_debug ("queued %" G_GSIZE_FORMAT " bytes of edits for %s", len, journal_file);
+    g_free (journal_file);
+    settings->journal_size += len;
+    g_string_truncate (settings->journal, 0);
+    return TRUE;
+}
+
+/*
+ * parse_serial: if the line at s is a serial header, store the serial in
+ *   serial and return TRUE.
+ */
+static gboolean
+parse_serial (const gchar *s, gsize len, guint *serial)
+{
+    gsize hlen = strlen (EE_SETTINGS_SERIAL_HEADER);
+
+    if (len <= hlen || strncmp (s, EE_SETTINGS_SERIAL_HEADER, hlen) != 0)
+        return FALSE;
+    if (!g_ascii_isdigit (s[hlen]))
+        return FALSE;
+    *serial = (guint) g_ascii_strtoull (s + hlen, NULL, 10);
     return TRUE;
 }
 
@@ -270,114 +591,163 @@ write_urls_file (EESettings *settings)
  *   is one URL per line.  leading and trailing whitespace is
  *   removed before parsing the URL.  username and password can be
  *   specified using the normal URL syntax, and will be used for HTTP
- *   authentication.
+ *   authentication.  the URL may be followed by attributes such as
+ *   "dwell=60 refresh=300" (see ee_playlist_insert).  the file is mapped
+ *   into memory and scanned in place; each URL is only parsed when it is
+ *   first displayed.
  */
 static gboolean
 read_urls_file (EESettings *settings)
 {
     gchar *urls_file = NULL;
-    GIOChannel *ioc;
+    GMappedFile *mapped;
     GError *error = NULL;
-    GIOStatus status;
-    gchar *s;
-    gsize len;
+    const gchar *s, *end, *eol, *line_end;
+    guint nlines = 0, nignored = 0;
     
     urls_file = g_build_filename (settings->home, "urls", NULL);
     if (!g_file_test (urls_file, G_FILE_TEST_IS_REGULAR))
         return write_urls_file (settings);
 
-    /* try to open the urls file */
-    ioc = g_io_channel_new_file (urls_file, "r", &error);
+    /* try to map the urls file */
+    mapped = g_mapped_file_new (urls_file, FALSE, &error);
     if (error) {
         g_critical ("failed to open %s: %s", urls_file, error->message);
         g_error_free (error);
         g_free (urls_file);
-        if (ioc)
-            g_io_channel_unref (ioc);
         return FALSE;
     }
     g_debug ("loading URLs from %s", urls_file);
-    g_free (urls_file);
 
-    /* loop reading each line of the file */
-    while (1) {
-        status = g_io_channel_read_line (ioc, &s, &len, NULL, &error);
-        if (status == G_IO_STATUS_AGAIN)
-            continue;
-        if (status == G_IO_STATUS_EOF)
-            break;
-        if (status == G_IO_STATUS_ERROR) {
-            g_critical ("error parsing URLs file: %s", error->message);
-            g_error_free (error);
-            g_io_channel_unref (ioc);
-            return FALSE;
-        }
+    /* an empty file may not have any contents mapped at all */
+    s = g_mapped_file_get_contents (mapped);
+    end = s ? s + g_mapped_file_get_length (mapped) : NULL;
+
+    /* loop over each line of the file */
+    while (s < end) {
+        eol = memchr (s, '\n', end - s);
+        if (eol == NULL)
+            eol = end;
         /* remove leading and trailing whitespace */
-        s = g_strstrip (s);
+        line_end = eol;
+        while (s < line_end && g_ascii_isspace (*s))
+            s++;
+        while (line_end > s && g_ascii_isspace (line_end[-1]))
+            line_end--;
+        nlines++;
+        /* the first line may hold the serial matching the journal */
+        if (nlines == 1 && parse_serial (s, line_end - s, &settings->urls_serial))
+            ;
         /* if string is empty or starts with a '#', then ignore it */
-        if (s[0] == '\0' || s[0] == '#')
+        else if (s == line_end || s[0] == '#')
             ;
         /* otherwise try to append the URL to the end of the urls list */
-        else
-            ee_settings_insert_url_from_string (settings, s, -1);
-        g_free (s);
+        else if (!ee_playlist_insert (settings->urls, s, line_end - s, -1)) {
+            g_warning ("ignoring line %u of %s: not an HTTP URL", nlines, urls_file);
+            nignored++;
+        }
+        s = eol + 1;
     }
+    g_debug ("loaded %u URLs from %s (%u ignored)",
+        ee_playlist_length (settings->urls), urls_file, nignored);
 
-    g_io_channel_unref (ioc);
+    g_mapped_file_unref (mapped);
+    g_free (urls_file);
     return TRUE;
 }
 
 /*
- * write_geometry_file: write window geometry to disk.
+ * read_journal_file: replay the playlist edits recorded in urls.journal
+ *   since the urls file was last written.  each line of the journal is
+ *   either "+POSITION URL [ATTRIBUTES]", "-POSITION" or
+ *   "=POSITION [ATTRIBUTES]".  the journal is only replayed if
+ *   its serial matches the urls file, and an unterminated last line (left
+ *   by a crash during an append) is ignored.
  */
 static gboolean
-write_geometry_file (EESettings *settings)
+read_journal_file (EESettings *settings)
 {
-    gchar *geometry_file = NULL;
+    gchar *journal_file = NULL;
+    GMappedFile *mapped;
     GError *error = NULL;
-    GIOChannel *ioc;
-    GIOStatus status;
-    gchar *curr = NULL;
-    gssize len = 0;
-    gsize nwritten = 0;
- 
-    /* open geometry file */
-    geometry_file = g_build_filename (settings->home, "geometry", NULL);
-    ioc = g_io_channel_new_file (geometry_file, "w", &error);
+    const gchar *start, *s, *end, *eol;
+    gchar *endptr;
+    gint64 position;
+    guint serial, nedits = 0;
+
+    /* if there is no journal, then start one the next time urls is saved */
+    journal_file = g_build_filename (settings->home, "urls.journal", NULL);
+    if (!g_file_test (journal_file, G_FILE_TEST_IS_REGULAR)) {
+        settings->compact_urls = TRUE;
+        g_free (journal_file);
+        return TRUE;
+    }
+
+    mapped = g_mapped_file_new (journal_file, FALSE, &error);
     if (error) {
-        g_critical ("failed to open %s for writing: %s", geometry_file, error->message);
+        g_critical ("failed to open %s: %s", journal_file, error->message);
         g_error_free (error);
-        g_free (geometry_file);
-        if (ioc)
-            g_io_channel_unref (ioc);
+        g_free (journal_file);
         return FALSE;
     }
+    start = s = g_mapped_file_get_contents (mapped);
+    end = s ? s + g_mapped_file_get_length (mapped) : NULL;
 
-    /* if window_geometry is not NULL, then write it to disk */
-    if (settings->window_geometry != NULL) {
-        curr = settings->window_geometry;
-        len = strlen(settings->window_geometry);
-        again:
-        status = g_io_channel_write_chars (ioc, curr, len, &nwritten, &error);
-        curr += nwritten;
-        len -= nwritten;
-        if (status == G_IO_STATUS_AGAIN)
-            goto again;
-        if (len > 0)
-            goto again;
-        if (status == G_IO_STATUS_ERROR) {
-            g_critical ("error writing geometry to %s: %s", geometry_file, error->message);
-            g_error_free (error);
-            g_free (geometry_file);
-            g_io_channel_unref (ioc);
-            return FALSE;
-        }
+    /* check the serial */
+    eol = s ? memchr (s, '\n', end - s) : NULL;
+    if (eol == NULL || !parse_serial (s, eol - s, &serial) || serial != settings->urls_serial) {
+        g_debug ("ignoring stale journal %s", journal_file);
+        settings->compact_urls = TRUE;
+        g_mapped_file_unref (mapped);
+        g_free (journal_file);
+        return TRUE;
+    }
+    s = eol + 1;
+
+    /* replay each complete record */
+    while (s < end && (eol = memchr (s, '\n', end - s)) != NULL) {
+        position = g_ascii_strtoll (s + 1, &endptr, 10);
+        if (endptr == s + 1 || endptr > eol)
+            g_warning ("ignoring malformed record in %s", journal_file);
+        else if (s[0] == '+' && *endptr == ' ')
+            ee_playlist_insert (settings->urls, endptr + 1, eol - endptr - 1, (gint) position);
+        else if (s[0] == '-')
+            ee_playlist_remove (settings->urls, (guint) position);
+        else if (s[0] == '=')
+            ee_playlist_set_attributes (settings->urls, (guint) position, endptr, eol - endptr);
         else
-            g_debug ("wrote geometry to %s", geometry_file);
+            g_warning ("ignoring malformed record in %s", journal_file);
+        nedits++;
+        s = eol + 1;
     }
+    /* a torn last record would corrupt the next append, so start over */
+    if (s < end)
+        settings->compact_urls = TRUE;
+    settings->journal_size = s - start;
+    g_debug ("replayed %u edits from %s", nedits, journal_file);
+
+    g_mapped_file_unref (mapped);
+    g_free (journal_file);
+    return TRUE;
+}
 
+/*
+ * write_geometry_file: queue window geometry to be written to disk.
+ */
+static gboolean
+write_geometry_file (EESettings *settings)
+{
+    gchar *geometry_file = NULL;
+    gchar *data;
+ 
+    EE_TRACE_BEGIN ("settings", "write_geometry_file", NULL);
+    /* if window_geometry is NULL, then the file is truncated */
+    geometry_file = g_build_filename (settings->home, "geometry", NULL);
+    data = g_strdup (settings->window_geometry ? settings->window_geometry : "");
+    ee_persist_write (settings->persist, geometry_file, data, strlen (data));
+    g_debug ("queued geometry for %s", geometry_file);
     g_free (geometry_file);
-    g_io_channel_unref (ioc);
+    EE_TRACE_END ("settings", "write_geometry_file");
     return TRUE;
 }
 
@@ -457,13 +827,14 @@ ee_settings_load (int *argc, char ***argv)
     EESettings *settings;
     GError *error = NULL;
     gchar *home = NULL;
-    gchar *cookies_file = NULL;
     gchar *geometry = NULL;
+    gchar *trace = NULL;
 
     GOptionEntry entries[] = 
     {
         { "config", 'c', 0, G_OPTION_ARG_FILENAME, &home, "Use DIR for storing configuration files", "DIR" },
         { "geometry", 0, 0, G_OPTION_ARG_STRING, &geometry, "Set the window geometry from the provided X geometry specification", "GEOMETRY" },
+        { "trace", 0, 0, G_OPTION_ARG_FILENAME, &trace, "Record trace events, and write them to FILE on SIGUSR2 and at exit", "FILE" },
         { "version", 0, G_OPTION_FLAG_NO_ARG, G_OPTION_ARG_CALLBACK, on_parse_version_option, "Display program version", NULL },
         { NULL }
     };
@@ -482,71 +853,174 @@ ee_settings_load (int *argc, char ***argv)
     }
     g_option_context_free (ct);
 
+    /* start tracing before anything is loaded, so loading is traced too */
+    if (trace) {
+        ee_trace_start (trace, 0);
+        g_free (trace);
+    }
+
+    /* if --config wasn't specified, then define it as $HOME/.eagle-eye */
+    if (home)
+        settings = ee_settings_open (home);
+    else {
+        home = g_build_filename (g_get_home_dir (), ".eagle-eye", NULL);
+        settings = ee_settings_open (home);
+        g_free (home);
+    }
+    if (settings == NULL)
+        return NULL;
+
+    /* load geometry from the command line, if specified */
+    if (geometry != NULL) {
+        if (settings->window_geometry)
+            g_free (settings->window_geometry);
+        settings->window_geometry = g_strdup (geometry);
+    }
+
+    return settings;
+}
+
+/*
+ * ee_settings_open: create and load a new settings object from the files
+ *   in the home directory, creating it if necessary.  Returns a new
+ *   EESettings object if loading succeeded, otherwise returns NULL.
+ */
+EESettings *
+ee_settings_open (const gchar *home)
+{
+    EESettings *settings;
+    gchar *cookies_file = NULL;
+    gchar *cache_dir = NULL;
+    gchar *loads_file = NULL;
+    gboolean loaded;
+
     /* alloc the settings object and set some defaults */
     settings = g_new0 (EESettings, 1);
-    settings->home = NULL;
-    settings->urls = NULL;
+    settings->home = g_strdup (home);
+    settings->urls = ee_playlist_new ();
+    settings->journal = g_string_new (NULL);
+    settings->profiles = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+        (GDestroyNotify) ee_profile_free);
     settings->cycle_time = 30;
+    settings->preload_time = 5;
+    settings->load_timeout = 30;
+    settings->pool_size = 2;
+    settings->memory_budget = 0;
+    settings->cache_size = 64;
+    settings->load_log_size = 1024;
+    settings->metrics_port = 0;
+    settings->snapshot_interval = 300;
+    settings->warmup_time = 10;
+    settings->max_connections = 0;
+    settings->max_connections_per_host = 0;
+    settings->idle_timeout = 0;
+    settings->tile_rows = 1;
+    settings->tile_columns = 1;
+    settings->watchdog_interval = 0;
+    settings->stall_threshold = 1000;
+    settings->refresh_on_show = TRUE;
     settings->start_fullscreen = FALSE;
     settings->disable_plugins = FALSE;
     settings->disable_scripts = FALSE;
     settings->small_toolbar = FALSE;
-
-    /* if --config wasn't specified, then define it as $HOME/.eagle-eye */
-    if (home)
-        settings->home = g_strdup (home);
-    else
-        settings->home = g_build_filename (g_get_home_dir (), ".eagle-eye", NULL);
+    settings->snapshot_mode = FALSE;
+    settings->multi_monitor = FALSE;
+    settings->aligned_cycle = FALSE;
+    settings->stall_backtrace = FALSE;
+    settings->duplicate_urls = EE_DUPLICATES_MOVE_TO_FRONT;
 
     /* create home if it doesn't exist */
     if (mkdir (settings->home, 0755) < 0 && errno != EEXIST) {
         g_warning ("failed to create %s: %s", settings->home, g_strerror (errno));
-        g_free (settings);
+        ee_settings_free (settings);
+        return NULL;
+    }
+
+    /* start the persistence thread */
+    settings->persist = ee_persist_new ();
+    if (settings->persist == NULL) {
+        ee_settings_free (settings);
         return NULL;
     }
   
     /* load config parameters */
-    if (!read_config_file (settings)) {
+    EE_TRACE_BEGIN ("settings", "read_config_file", NULL);
+    loaded = read_config_file (settings);
+    EE_TRACE_END ("settings", "read_config_file");
+    if (!loaded) {
         ee_settings_free (settings);
         return NULL;
     }
 
-    /* load the urls file */
-    if (!read_urls_file (settings)) {
+    /* load the urls file, then apply the edits made since it was written */
+    EE_TRACE_BEGIN ("settings", "read_urls_file", NULL);
+    loaded = read_urls_file (settings) && read_journal_file (settings);
+    EE_TRACE_END ("settings", "read_urls_file");
+    if (!loaded) {
         ee_settings_free (settings);
         return NULL;
     }
 
     /* load saved window geometry if specified in the config */
-    if (!read_geometry_file (settings)) {
+    EE_TRACE_BEGIN ("settings", "read_geometry_file", NULL);
+    loaded = read_geometry_file (settings);
+    EE_TRACE_END ("settings", "read_geometry_file");
+    if (!loaded) {
         ee_settings_free (settings);
         return NULL;
     }
 
-    /* load geometry from the command line, if specified */
-    if (geometry != NULL) {
-        if (settings->window_geometry)
-            g_free (settings->window_geometry);
-        settings->window_geometry = g_strdup (geometry);
-    }
-
     /* open the cookie jar */
     cookies_file = g_build_filename (settings->home, "cookies", NULL);
     settings->cookie_jar = soup_cookie_jar_text_new (cookies_file, FALSE);
     g_free (cookies_file);
 
+    /* open the HTTP cache, unless it is disabled */
+    if (settings->cache_size > 0) {
+        cache_dir = g_build_filename (settings->home, "cache", NULL);
+        settings->cache = ee_cache_new (cache_dir, settings->cache_size);
+        g_free (cache_dir);
+    }
+
+    /* open the page load log, unless it is disabled.  the metrics need
+     * the page load timings even if they aren't logged */
+    if (settings->load_log_size > 0)
+        loads_file = g_build_filename (settings->home, "loads.csv", NULL);
+    if (loads_file || settings->metrics_port > 0)
+        settings->loads = ee_load_log_new (settings->persist, loads_file,
+            (gsize) MAX (settings->load_log_size, 0) * 1024);
+    g_free (loads_file);
+
     return settings;
 }
 
 /*
- * ee_settings_insert_url: insert a URL at the specified position.  if the
- *   URL is not valid for HTTP, then returns FALSE, otherwise returns TRUE.
+ * ee_settings_insert_url: insert a URL at the specified position, applying
+ *   the duplicate-urls policy if the URL is already in the playlist.  if
+ *   the URL is not valid for HTTP, or it is a duplicate which is rejected,
+ *   then returns FALSE, otherwise returns TRUE.  under move-to-front, a
+ *   duplicate is moved to the front whatever position is.
  */
 gboolean
 ee_settings_insert_url (EESettings *settings, SoupURI *url, gint position)
 {
-    SoupURI *copy;
+    return ee_settings_insert_url_with_policy (settings, url, position,
+        settings->duplicate_urls);
+}
+
+/*
+ * ee_settings_insert_url_with_policy: like ee_settings_insert_url, but
+ *   duplicates are handled according to policy instead of the configured
+ *   duplicate-urls policy.
+ */
+gboolean
+ee_settings_insert_url_with_policy (EESettings *settings, SoupURI *url, gint position, gint policy)
+{
+    gchar attrs[EE_URL_ATTRIBUTES_MAX];
+    EEUrl *entry;
     gchar *id;
+    gint existing;
+    gchar moved[EE_URL_ATTRIBUTES_MAX] = "";
 
     g_assert (settings != NULL);
     g_assert (url != NULL);
@@ -557,11 +1031,35 @@ ee_settings_insert_url (EESettings *settings, SoupURI *url, gint position)
         g_free (id);
         return FALSE;
     }
-    copy = soup_uri_copy (url);
-    id = soup_uri_to_string (copy, FALSE);
-    settings->urls = g_list_insert (settings->urls, copy, position);  
-    g_debug ("inserted URL %s at position %i", id, position);
-    g_free (id);
+
+    /* check whether the URL is already in the playlist */
+    existing = -1;
+    if (policy != EE_DUPLICATES_ALLOW)
+        existing = ee_playlist_find_uri (settings->urls, url);
+    if (existing >= 0 && policy == EE_DUPLICATES_REJECT) {
+        g_debug ("not inserting URL at position %i: duplicate of %i", position, existing);
+        return FALSE;
+    }
+    if (existing >= 0 && policy == EE_DUPLICATES_MOVE_TO_FRONT) {
+        /* wherever it was asked to go, the entry goes to the front, and
+         * keeps all of its attributes */
+        g_debug ("moving URL from position %i to the front", existing);
+        ee_url_format_attributes (ee_playlist_get (settings->urls, existing), moved, sizeof (moved));
+        ee_settings_remove_url (settings, existing);
+        position = 0;
+    }
+
+    /* record the actual position, so the journal doesn't depend on the
+     * playlist length when it is replayed */
+    if (position < 0 || (guint) position > ee_playlist_length (settings->urls))
+        position = ee_playlist_length (settings->urls);
+    if (!ee_playlist_insert_uri (settings->urls, url, position))
+        return FALSE;
+    ee_playlist_set_attributes (settings->urls, (guint) position, moved, -1);
+    entry = ee_playlist_get (settings->urls, position);
+    ee_url_format_attributes (entry, attrs, sizeof (attrs));
+    g_string_append_printf (settings->journal, "+%i %s%s\n", position, entry->text, attrs);
+    g_debug ("inserted URL at position %i", position);
     return TRUE;
 }
 
@@ -597,46 +1095,190 @@ ee_settings_insert_url_from_string (EESettings *settings, const gchar *url, gint
 gboolean
 ee_settings_remove_url (EESettings *settings, guint index)
 {
-    GList *item;
+    if (!ee_playlist_remove (settings->urls, index))
+        return FALSE;
+    g_string_append_printf (settings->journal, "-%u\n", index);
+    return TRUE;
+}
+
+/*
+ * ee_settings_set_url_attributes: replace all of the attributes of the URL
+ *   at index with attrs, as formatted by ee_url_format_attributes.
+ *   attributes which aren't in attrs go back to their defaults.  returns
+ *   FALSE if index is out of range.
+ */
+gboolean
+ee_settings_set_url_attributes (EESettings *settings, guint index, const gchar *attrs)
+{
+    gchar formatted[EE_URL_ATTRIBUTES_MAX];
 
-    item = g_list_nth (settings->urls, index);
-    if (item == NULL)
+    if (!ee_playlist_set_attributes (settings->urls, index, attrs, -1))
         return FALSE;
-    soup_uri_free ((SoupURI *) item->data);
-    settings->urls = g_list_delete_link (settings->urls, item);
+    ee_url_format_attributes (ee_playlist_get (settings->urls, index), formatted, sizeof (formatted));
+    g_string_append_printf (settings->journal, "=%u%s\n", index, formatted);
     return TRUE;
 }
 
 /*
- * ee_settings_save: save settings to disk.
+ * ee_settings_find_url: returns the index of url in the playlist, or -1 if
+ *   it isn't in the playlist.  URLs which differ only in credentials, the
+ *   case of the scheme or host, or an explicit default port are the same.
+ */
+gint
+ee_settings_find_url (EESettings *settings, const gchar *url)
+{
+    return ee_playlist_find (settings->urls, url, -1);
+}
+
+/*
+ * ee_settings_get_profile: returns the render profile of url, or NULL if
+ *   the URL doesn't name one or the named profile isn't defined.
+ */
+EEProfile *
+ee_settings_get_profile (EESettings *settings, EEUrl *url)
+{
+    EEProfile *profile;
+
+    if (url == NULL || url->profile == NULL)
+        return NULL;
+    profile = g_hash_table_lookup (settings->profiles, url->profile);
+    if (profile == NULL)
+        g_debug ("URL %u uses undefined profile %s", url->index, url->profile);
+    return profile;
+}
+
+/*
+ * on_save_timeout: save settings once changes have stopped arriving.
+ */
+static gboolean
+on_save_timeout (EESettings *settings)
+{
+    settings->save_id = 0;
+    ee_settings_save (settings);
+    return FALSE;
+}
+
+/*
+ * ee_settings_changed: mark the specified files as dirty.  the dirty files
+ *   are saved EE_SETTINGS_SAVE_DELAY milliseconds after the first change, so
+ *   a burst of changes (such as dragging the cycle time spinner) results in
+ *   a single write.
+ */
+void
+ee_settings_changed (EESettings *settings, guint files)
+{
+    settings->dirty |= files;
+    /* changes made inside a batch are saved when the batch is committed */
+    if (settings->batch > 0)
+        return;
+    if (settings->save_id == 0)
+        settings->save_id = g_timeout_add (EE_SETTINGS_SAVE_DELAY,
+            (GSourceFunc) on_save_timeout, settings);
+}
+
+/*
+ * ee_settings_begin_batch: start a batch of changes.  changes made until
+ *   the matching ee_settings_commit_batch are applied in memory as usual,
+ *   but aren't written to disk until the batch is committed.  batches can
+ *   be nested, in which case only the outermost commit saves.
+ */
+void
+ee_settings_begin_batch (EESettings *settings)
+{
+    settings->batch++;
+}
+
+/*
+ * ee_settings_commit_batch: finish a batch of changes started with
+ *   ee_settings_begin_batch, and queue everything changed during the batch
+ *   to be written to disk at once.
+ */
+void
+ee_settings_commit_batch (EESettings *settings)
+{
+    g_return_if_fail (settings->batch > 0);
+
+    if (--settings->batch == 0 && settings->dirty)
+        ee_settings_save (settings);
+}
+
+/*
+ * ee_settings_save: queue the dirty files to be written to disk by the
+ *   persistence thread.  this doesn't wait for the writes to complete.
  */
 gboolean
 ee_settings_save (EESettings *settings)
 {
-    write_config_file (settings);
-    write_urls_file (settings);
-    write_geometry_file (settings);
+    gint64 start = g_get_monotonic_time ();
+
+    if (settings->save_id > 0) {
+        g_source_remove (settings->save_id);
+        settings->save_id = 0;
+    }
+    if (settings->dirty == 0)
+        return TRUE;
+    if (settings->dirty & EE_SETTINGS_CONFIG)
+        write_config_file (settings);
+    if (settings->dirty & EE_SETTINGS_URLS)
+        append_journal (settings);
+    if (settings->dirty & EE_SETTINGS_GEOMETRY)
+        write_geometry_file (settings);
+    settings->dirty = 0;
+    /* the writes themselves happen on the persist thread, this is how
+     * long the main loop was held up */
+    settings->saves++;
+    settings->save_time += g_get_monotonic_time () - start;
     return TRUE;
 }
 
+/*
+ * ee_settings_flush: write the dirty files to disk, and wait for all
+ *   queued writes to complete.
+ */
+void
+ee_settings_flush (EESettings *settings)
+{
+    ee_settings_save (settings);
+    if (settings->loads)
+        ee_load_log_flush (settings->loads);
+    ee_persist_sync (settings->persist);
+}
+
 /*
  * ee_settings_free: free all memory associated with the settings object.
  */
 void
 ee_settings_free (EESettings *settings)
 {
-    GList *item;
-
     /* free urls list */
-    if (settings->urls) {
-        for (item = settings->urls; item; item = g_list_next (item))
-            soup_uri_free ((SoupURI *) item->data);
-        g_list_free (settings->urls);
-    }
+    if (settings->urls)
+        ee_playlist_free (settings->urls);
 
     /* unref the cookie_jar */
     if (settings->cookie_jar)
         g_object_unref (settings->cookie_jar);
 
+    /* save the HTTP cache index */
+    if (settings->cache)
+        ee_cache_free (settings->cache);
+    if (settings->auth)
+        ee_auth_cache_free (settings->auth);
+
+    /* queue the last page load records, before the persist thread stops */
+    if (settings->loads)
+        ee_load_log_free (settings->loads);
+
+    /* stop the persistence thread, after it finishes any queued writes */
+    if (settings->save_id > 0)
+        g_source_remove (settings->save_id);
+    if (settings->persist)
+        ee_persist_free (settings->persist);
+    if (settings->keyfile)
+        g_key_file_free (settings->keyfile);
+    if (settings->journal)
+        g_string_free (settings->journal, TRUE);
+    if (settings->profiles)
+        g_hash_table_destroy (settings->profiles);
+
     g_free (settings);
 }
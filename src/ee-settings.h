@@ -3,24 +3,89 @@
 
 #include <glib.h>
 #include <libsoup/soup.h>
+#include <ee-auth-cache.h>
+#include <ee-cache.h>
+#include <ee-load-log.h>
+#include <ee-persist.h>
+#include <ee-playlist.h>
+#include <ee-profile.h>
+
+enum {
+    EE_SETTINGS_CONFIG = 1 << 0,
+    EE_SETTINGS_URLS = 1 << 1,
+    EE_SETTINGS_GEOMETRY = 1 << 2
+};
+
+/* what to do when inserting a URL which is already in the playlist */
+enum {
+    EE_DUPLICATES_REJECT,
+    EE_DUPLICATES_MOVE_TO_FRONT,
+    EE_DUPLICATES_ALLOW
+};
 
 typedef struct {
     gchar *home;
-    GList *urls;
+    EEPlaylist *urls;
     gint cycle_time;
+    gint preload_time;
+    gint load_timeout;
+    gint pool_size;
+    gint memory_budget;
+    gboolean refresh_on_show;
     gboolean start_fullscreen;
     gboolean disable_plugins;
     gboolean disable_scripts;
     gboolean small_toolbar;
+    gboolean snapshot_mode;
+    gboolean multi_monitor;
+    gboolean aligned_cycle;
+    gboolean stall_backtrace;
+    gint duplicate_urls;
+    gint cache_size;
+    gint load_log_size;
+    gint metrics_port;
+    gint snapshot_interval;
+    gint warmup_time;
+    gint max_connections;
+    gint max_connections_per_host;
+    gint idle_timeout;
+    gint tile_rows;
+    gint tile_columns;
+    gint watchdog_interval;
+    gint stall_threshold;
     gchar *window_geometry;
     SoupCookieJar *cookie_jar;
+    EECache *cache;
+    EEAuthCache *auth;
+    EELoadLog *loads;
+    GKeyFile *keyfile;
+    GHashTable *profiles;
+    EEPersist *persist;
+    guint urls_serial;
+    GString *journal;
+    gsize journal_size;
+    gboolean compact_urls;
+    guint dirty;
+    guint save_id;
+    guint saves;
+    gint64 save_time;
+    guint batch;
 } EESettings;
 
 EESettings *ee_settings_load (int *argc, char ***argv);
+EESettings *ee_settings_open (const gchar *home);
 gboolean ee_settings_insert_url (EESettings *settings, SoupURI *url, gint position);
+gboolean ee_settings_insert_url_with_policy (EESettings *settings, SoupURI *url, gint position, gint policy);
 gboolean ee_settings_insert_url_from_string (EESettings *settings, const gchar *url, gint position);
 gboolean ee_settings_remove_url (EESettings *settings, guint index);
+gboolean ee_settings_set_url_attributes (EESettings *settings, guint index, const gchar *attrs);
+gint ee_settings_find_url (EESettings *settings, const gchar *url);
+EEProfile *ee_settings_get_profile (EESettings *settings, EEUrl *url);
+void ee_settings_changed (EESettings *settings, guint files);
+void ee_settings_begin_batch (EESettings *settings);
+void ee_settings_commit_batch (EESettings *settings);
 gboolean ee_settings_save (EESettings *settings);
+void ee_settings_flush (EESettings *settings);
 void ee_settings_free (EESettings *settings);
 
 #endif
@@ -0,0 +1,280 @@
+#include <string.h>
+#include <glib.h>
+#include <gtk/gtk.h>
+#include <webkit/webkit.h>
+#include <ee-snapshots.h>
+
+/* how long to let a page settle after it has loaded before capturing it, in ms */
+#define EE_SNAPSHOTS_SETTLE_TIME 500
+
+/*
+ * get_time: returns the monotonic time in seconds.
+ */
+static gint64
+get_time (void)
+{
+    return g_get_monotonic_time () / G_USEC_PER_SEC;
+}
+
+/*
+ * free_snapshot: free a snapshot and its image.
+ */
+static void
+free_snapshot (EESnapshot *snapshot)
+{
+    if (snapshot->pixbuf)
+        g_object_unref (snapshot->pixbuf);
+    g_free (snapshot);
+}
+
+/*
+ * finish_render: stop rendering the current URL.  the snapshot is marked
+ *   as taken even if no image was captured, so a broken URL is only
+ *   retried after the refresh interval.  the snapshot is keyed on a copy
+ *   of the URL, since the entry may have been removed while rendering.
+ */
+static void
+finish_render (EESnapshots *snapshots, GdkPixbuf *pixbuf)
+{
+    EESnapshot *snapshot;
+
+    snapshot = (EESnapshot *) g_hash_table_lookup (snapshots->snapshots, snapshots->current);
+    if (snapshot == NULL) {
+        snapshot = g_new0 (EESnapshot, 1);
+        g_hash_table_insert (snapshots->snapshots, snapshots->current, snapshot);
+    }
+    else
+        g_free (snapshots->current);
+    if (pixbuf) {
+        if (snapshot->pixbuf)
+            g_object_unref (snapshot->pixbuf);
+        snapshot->pixbuf = pixbuf;
+    }
+    snapshot->taken = get_time ();
+    snapshots->current = NULL;
+    snapshots->current_url = -1;
+}
+
+/*
+ * on_capture: copy the rendered page into a pixbuf.
+ */
+static gboolean
+on_capture (EESnapshots *snapshots)
+{
+    GdkPixbuf *pixbuf;
+
+    snapshots->capture_id = 0;
+    if (snapshots->current == NULL)
+        return FALSE;
+    pixbuf = gtk_offscreen_window_get_pixbuf (GTK_OFFSCREEN_WINDOW (snapshots->offscreen));
+    g_debug ("captured snapshot of %s", snapshots->current);
+    finish_render (snapshots, pixbuf);
+    return FALSE;
+}
+
+/*
+ * on_load_finished: give the page a moment to run its scripts and lay
+ *   itself out, then capture it.
+ */
+static void
+on_load_finished (WebKitWebView *       webview,
+                  WebKitWebFrame *      frame,
+                  EESnapshots *         snapshots)
+{
+    if (snapshots->current == NULL || snapshots->capture_id > 0)
+        return;
+    snapshots->capture_id = g_timeout_add (EE_SNAPSHOTS_SETTLE_TIME,
+        (GSourceFunc) on_capture, snapshots);
+}
+
+/*
+ * is_removed: returns TRUE if url is no longer in playlist.
+ */
+static gboolean
+is_removed (const gchar *url, EESnapshot *snapshot, EEPlaylist *playlist)
+{
+    return ee_playlist_find (playlist, url, -1) < 0;
+}
+
+/*
+ * prune_snapshots: drop the images of URLs which have been removed from
+ *   the playlist or edited, each of which holds a full window of pixels.
+ */
+static void
+prune_snapshots (EESnapshots *snapshots)
+{
+    guint n;
+
+    n = g_hash_table_foreach_remove (snapshots->snapshots,
+        (GHRFunc) is_removed, snapshots->playlist);
+    if (n > 0)
+        g_debug ("dropped %u snapshots of removed URLs", n);
+}
+
+/*
+ * on_tick: start rendering the next URL whose snapshot is missing or older
+ *   than the refresh interval.  only one URL is rendered at a time, and a
+ *   URL which doesn't finish loading in time is skipped.  each time the
+ *   cursor wraps around, snapshots of removed URLs are dropped.
+ */
+static gboolean
+on_tick (EESnapshots *snapshots)
+{
+    EESnapshot *snapshot;
+    EEUrl *url;
+    gint64 now = get_time ();
+    guint i, n;
+    gint previous;
+
+    if (snapshots->current) {
+        if (now < snapshots->deadline)
+            return TRUE;
+        g_debug ("giving up on snapshot of %s", snapshots->current);
+        webkit_web_view_stop_loading (snapshots->webview);
+        if (snapshots->capture_id > 0) {
+            g_source_remove (snapshots->capture_id);
+            snapshots->capture_id = 0;
+        }
+        finish_render (snapshots, NULL);
+    }
+
+    n = ee_playlist_length (snapshots->playlist);
+    for (i = 0; i < n; i++) {
+        previous = snapshots->cursor;
+        snapshots->cursor = ee_playlist_next (snapshots->playlist, snapshots->cursor);
+        if (snapshots->cursor <= previous)
+            prune_snapshots (snapshots);
+        if ((guint) snapshots->cursor % snapshots->partitions != snapshots->partition)
+            continue;
+        url = ee_playlist_get_parsed (snapshots->playlist, snapshots->cursor);
+        if (url == NULL)
+            continue;
+        snapshot = (EESnapshot *) g_hash_table_lookup (snapshots->snapshots, url->display);
+        if (snapshot && now - snapshot->taken < snapshots->interval)
+            continue;
+        g_debug ("rendering snapshot of %s", url->display);
+        snapshots->current = g_strdup (url->display);
+        snapshots->current_url = snapshots->cursor;
+        snapshots->deadline = now + snapshots->timeout_func (snapshots->data, snapshots->cursor);
+        webkit_web_view_load_uri (snapshots->webview, url->display);
+        break;
+    }
+    return TRUE;
+}
+
+/*
+ * ee_snapshots_new: create a snapshot cache which renders each URL in the
+ *   playlist in an offscreen webview every interval seconds, and keeps an
+ *   image of the result.  setup_func is called on the offscreen webview,
+ *   so the owner can connect its own signal handlers, and timeout_func
+ *   returns how many seconds the entry at an index may take to load.
+ */
+EESnapshots *
+ee_snapshots_new (EEPlaylist *              playlist,
+                  guint                     interval,
+                  WebKitWebSettings *       websettings,
+                  EESnapshotsSetupFunc      setup_func,
+                  EESnapshotsTimeoutFunc    timeout_func,
+                  gpointer                  data)
+{
+    EESnapshots *snapshots;
+
+    snapshots = g_new0 (EESnapshots, 1);
+    snapshots->playlist = playlist;
+    snapshots->interval = MAX (interval, 1);
+    snapshots->partitions = 1;
+    snapshots->timeout_func = timeout_func;
+    snapshots->data = data;
+    snapshots->snapshots = g_hash_table_new_full (g_str_hash, g_str_equal,
+        g_free, (GDestroyNotify) free_snapshot);
+
+    /* the cursor follows edits to the playlist like the main window's */
+    snapshots->cursor = -1;
+    ee_playlist_add_cursor (playlist, &snapshots->cursor);
+    snapshots->current_url = -1;
+    ee_playlist_add_cursor (playlist, &snapshots->current_url);
+
+    /* the offscreen window is realized, but never appears on screen */
+    snapshots->offscreen = gtk_offscreen_window_new ();
+    snapshots->webview = WEBKIT_WEB_VIEW (webkit_web_view_new ());
+    webkit_web_view_set_settings (snapshots->webview, websettings);
+    gtk_container_add (GTK_CONTAINER (snapshots->offscreen), GTK_WIDGET (snapshots->webview));
+    g_signal_connect (snapshots->webview, "load-finished",
+        G_CALLBACK (on_load_finished), snapshots);
+    if (setup_func)
+        setup_func (snapshots->webview, data);
+    gtk_widget_show_all (snapshots->offscreen);
+
+    snapshots->tick_id = g_timeout_add_seconds (1, (GSourceFunc) on_tick, snapshots);
+    return snapshots;
+}
+
+/*
+ * ee_snapshots_lookup: returns the most recent image of url, or NULL if
+ *   it hasn't been rendered yet.  the snapshot cache retains ownership of
+ *   the image.
+ */
+GdkPixbuf *
+ee_snapshots_lookup (EESnapshots *snapshots, const gchar *url)
+{
+    EESnapshot *snapshot;
+
+    snapshot = (EESnapshot *) g_hash_table_lookup (snapshots->snapshots, url);
+    return snapshot ? snapshot->pixbuf : NULL;
+}
+
+/*
+ * ee_snapshots_get_current: returns the entry being rendered, or NULL if
+ *   nothing is being rendered, or the entry has been removed from the
+ *   playlist since rendering started.
+ */
+EEUrl *
+ee_snapshots_get_current (EESnapshots *snapshots)
+{
+    EEUrl *url;
+
+    if (snapshots->current == NULL)
+        return NULL;
+    url = ee_playlist_get_parsed (snapshots->playlist, snapshots->current_url);
+    if (url == NULL || strcmp (url->display, snapshots->current) != 0)
+        return NULL;
+    return url;
+}
+
+/*
+ * ee_snapshots_set_size: render pages at the size they will be shown.
+ */
+void
+ee_snapshots_set_size (EESnapshots *snapshots, gint width, gint height)
+{
+    gtk_widget_set_size_request (snapshots->offscreen, width, height);
+}
+
+/*
+ * ee_snapshots_set_partition: only render the URLs whose index modulo
+ *   partitions is partition, when the playlist is split between windows.
+ */
+void
+ee_snapshots_set_partition (EESnapshots *snapshots, guint partition, guint partitions)
+{
+    snapshots->partitions = MAX (partitions, 1);
+    snapshots->partition = partition % snapshots->partitions;
+}
+
+/*
+ * ee_snapshots_free: stop rendering, and free the snapshot cache and all
+ *   of its images.
+ */
+void
+ee_snapshots_free (EESnapshots *snapshots)
+{
+    g_source_remove (snapshots->tick_id);
+    if (snapshots->capture_id > 0)
+        g_source_remove (snapshots->capture_id);
+    ee_playlist_remove_cursor (snapshots->playlist, &snapshots->cursor);
+    ee_playlist_remove_cursor (snapshots->playlist, &snapshots->current_url);
+    g_free (snapshots->current);
+    gtk_widget_destroy (snapshots->offscreen);
+    g_hash_table_destroy (snapshots->snapshots);
+    g_free (snapshots);
+}
@@ -0,0 +1,43 @@
+#ifndef EE_SNAPSHOTS_H
+#define EE_SNAPSHOTS_H
+
+#include <gtk/gtk.h>
+#include <webkit/webkit.h>
+#include <ee-playlist.h>
+
+typedef struct {
+    GdkPixbuf *pixbuf;
+    gint64 taken;
+} EESnapshot;
+
+typedef void (*EESnapshotsSetupFunc) (WebKitWebView *webview, gpointer data);
+typedef guint (*EESnapshotsTimeoutFunc) (gpointer data, gint index);
+
+typedef struct {
+    EEPlaylist *playlist;
+    GtkWidget *offscreen;
+    WebKitWebView *webview;
+    GHashTable *snapshots;
+    gint cursor;
+    guint partition;
+    guint partitions;
+    gchar *current;
+    gint current_url;
+    gint64 deadline;
+    EESnapshotsTimeoutFunc timeout_func;
+    gpointer data;
+    guint interval;
+    guint tick_id;
+    guint capture_id;
+} EESnapshots;
+
+EESnapshots *ee_snapshots_new (EEPlaylist *playlist, guint interval, WebKitWebSettings *websettings,
+                               EESnapshotsSetupFunc setup_func, EESnapshotsTimeoutFunc timeout_func,
+                               gpointer data);
+GdkPixbuf *ee_snapshots_lookup (EESnapshots *snapshots, const gchar *url);
+EEUrl *ee_snapshots_get_current (EESnapshots *snapshots);
+void ee_snapshots_set_size (EESnapshots *snapshots, gint width, gint height);
+void ee_snapshots_set_partition (EESnapshots *snapshots, guint partition, guint partitions);
+void ee_snapshots_free (EESnapshots *snapshots);
+
+#endif
@@ -0,0 +1,279 @@
+#include <glib.h>
+#include <gtk/gtk.h>
+#include <webkit/webkit.h>
+#include <ee-tile-grid.h>
+
+/* the minimum time between two panes starting a load, in milliseconds.
+ * panes which come due together are started this far apart, so they
+ * don't all compete for the CPU and network at the same moment. */
+#define EE_TILE_GRID_STAGGER 2000
+
+static void on_pane_timeout (EETilePane *pane);
+
+/*
+ * get_time: returns the monotonic time in milliseconds.
+ */
+static gint64
+get_time (void)
+{
+    return g_get_monotonic_time () / 1000;
+}
+
+/*
+ * step_slice: returns the index of the URL after (or before, if forward is
+ *   FALSE) the current URL of pane within its slice of the playlist, or -1
+ *   if the slice is empty.  the slice of a pane is every URL whose index
+ *   modulo the number of panes is the pane's slot.  when the playlist is
+ *   split between windows, the grid's partition is sliced the same way.
+ */
+static gint
+step_slice (EETilePane *pane, gboolean forward)
+{
+    EEPlaylist *urls = pane->grid->settings->urls;
+    gint n = (gint) ee_playlist_length (urls);
+    gint slots = (gint) (pane->grid->panes->len * pane->grid->partitions);
+    gint slot = (gint) (pane->grid->partition * pane->grid->panes->len + pane->slot);
+    gint i;
+
+    if (slot >= n)
+        return -1;
+    if (pane->curr_url < 0)
+        return slot;
+    /* the cursor may have drifted off the slice as URLs were inserted and
+     * removed, so step one at a time until it lands back on the slice */
+    i = pane->curr_url;
+    do {
+        i += forward ? 1 : -1;
+        if (i >= n)
+            i = 0;
+        else if (i < 0)
+            i = n - 1;
+    } while (i % slots != slot);
+    return i;
+}
+
+/*
+ * get_dwell: returns how many seconds pane shows its current URL for.
+ */
+static guint
+get_dwell (EETilePane *pane)
+{
+    EEUrl *url = ee_playlist_get (pane->grid->settings->urls, pane->curr_url);
+
+    if (url && url->dwell > 0)
+        return url->dwell;
+    return (guint) MAX (pane->grid->settings->cycle_time, 1);
+}
+
+/*
+ * schedule_pane: run on_pane_timeout for pane delay milliseconds from now.
+ */
+static void
+schedule_pane (EETilePane *pane, guint delay)
+{
+    EETileGrid *grid = pane->grid;
+
+    if (pane->timeout_id > 0)
+        ee_scheduler_remove (grid->scheduler, pane->timeout_id);
+    pane->timeout_id = ee_scheduler_add (grid->scheduler, delay,
+        (EESchedulerFunc) on_pane_timeout, pane);
+}
+
+/*
+ * load_pane: load the current URL of pane, or leave the pane blank if its
+ *   slice is empty.
+ */
+static void
+load_pane (EETilePane *pane)
+{
+    EETileGrid *grid = pane->grid;
+    EEUrl *url;
+
+    url = ee_playlist_get_parsed (grid->settings->urls, pane->curr_url);
+    if (url == NULL) {
+        webkit_web_view_load_uri (pane->webview, "about:blank");
+        return;
+    }
+    g_debug ("pane %u: opening URL: %s", pane->slot, url->display);
+    if (grid->load_func)
+        grid->load_func (pane->webview, url, grid->data);
+    webkit_web_view_load_uri (pane->webview, url->display);
+}
+
+/*
+ * on_pane_timeout: cycle pane to the next URL in its slice once its dwell
+ *   time has expired.  if another pane started loading too recently, then
+ *   the switch is pushed back until the stagger interval has passed.
+ */
+static void
+on_pane_timeout (EETilePane *pane)
+{
+    EETileGrid *grid = pane->grid;
+    gint64 now = get_time ();
+
+    pane->timeout_id = 0;
+    if (now < grid->next_load) {
+        schedule_pane (pane, (guint) (grid->next_load - now));
+        return;
+    }
+    grid->next_load = now + EE_TILE_GRID_STAGGER;
+    pane->curr_url = step_slice (pane, TRUE);
+    load_pane (pane);
+    if (!grid->paused)
+        schedule_pane (pane, get_dwell (pane) * 1000);
+}
+
+/*
+ * ee_tile_grid_new: create a grid of rows by columns panes, which share
+ *   websettings and the WebKit session.  each pane cycles through its own
+ *   slice of the playlist on its own schedule.  setup_func is called for
+ *   each new webview, and load_func just before a pane loads a URL.  the
+ *   panes start one after another, EE_TILE_GRID_STAGGER milliseconds apart.
+ */
+EETileGrid *
+ee_tile_grid_new (EESettings *          settings,
+                  EEScheduler *         scheduler,
+                  guint                 rows,
+                  guint                 columns,
+                  WebKitWebSettings *   websettings,
+                  EETileGridSetupFunc   setup_func,
+                  EETileGridLoadFunc    load_func,
+                  gpointer              data)
+{
+    EETileGrid *grid;
+    EETilePane *pane;
+    GtkWidget *table;
+    GtkWidget *webview;
+    GtkWidget *sw;
+    guint i;
+
+    grid = g_new0 (EETileGrid, 1);
+    grid->settings = settings;
+    grid->scheduler = scheduler;
+    grid->panes = g_ptr_array_new ();
+    grid->partitions = 1;
+    grid->load_func = load_func;
+    grid->data = data;
+
+    rows = MAX (rows, 1);
+    columns = MAX (columns, 1);
+    table = gtk_table_new (rows, columns, TRUE);
+    grid->table = GTK_TABLE (table);
+
+    for (i = 0; i < rows * columns; i++) {
+        webview = webkit_web_view_new ();
+        webkit_web_view_set_settings (WEBKIT_WEB_VIEW (webview), websettings);
+        webkit_web_view_set_full_content_zoom (WEBKIT_WEB_VIEW (webview), TRUE);
+        sw = gtk_scrolled_window_new (NULL, NULL);
+        gtk_scrolled_window_set_policy (GTK_SCROLLED_WINDOW (sw),
+            GTK_POLICY_AUTOMATIC, GTK_POLICY_AUTOMATIC);
+        gtk_container_add (GTK_CONTAINER (sw), webview);
+        gtk_table_attach_defaults (grid->table, sw,
+            i % columns, i % columns + 1, i / columns, i / columns + 1);
+
+        pane = g_slice_new0 (EETilePane);
+        pane->grid = grid;
+        pane->webview = WEBKIT_WEB_VIEW (webview);
+        pane->page = sw;
+        pane->slot = i;
+        pane->curr_url = -1;
+        ee_playlist_add_cursor (settings->urls, &pane->curr_url);
+        g_ptr_array_add (grid->panes, pane);
+        if (setup_func)
+            setup_func (pane->webview, data);
+    }
+
+    /* start the panes off staggered, rather than all at once */
+    for (i = 0; i < grid->panes->len; i++)
+        schedule_pane (g_ptr_array_index (grid->panes, i), i * EE_TILE_GRID_STAGGER);
+    g_debug ("created %ux%u tile grid", columns, rows);
+    return grid;
+}
+
+/*
+ * ee_tile_grid_get_widget: returns the widget to pack into the window.
+ */
+GtkWidget *
+ee_tile_grid_get_widget (EETileGrid *grid)
+{
+    return GTK_WIDGET (grid->table);
+}
+
+/*
+ * ee_tile_grid_set_partition: split the playlist between windows.  the
+ *   playlist is dealt out in runs of one URL per pane, and the grid only
+ *   shows every partitions'th run, starting with run partition.  that is,
+ *   the URLs whose index modulo panes * partitions lies between
+ *   partition * panes and (partition + 1) * panes - 1.
+ */
+void
+ee_tile_grid_set_partition (EETileGrid *grid, guint partition, guint partitions)
+{
+    grid->partitions = MAX (partitions, 1);
+    grid->partition = partition % grid->partitions;
+}
+
+/*
+ * ee_tile_grid_step: move every pane to the next (or previous, if forward
+ *   is FALSE) URL in its slice.  the loads are staggered as usual, and if
+ *   the grid isn't paused then each pane's dwell time starts over.
+ */
+void
+ee_tile_grid_step (EETileGrid *grid, gboolean forward)
+{
+    EETilePane *pane;
+    guint i;
+
+    for (i = 0; i < grid->panes->len; i++) {
+        pane = g_ptr_array_index (grid->panes, i);
+        /* on_pane_timeout steps forward, so step back twice to go back */
+        if (!forward && pane->curr_url >= 0) {
+            pane->curr_url = step_slice (pane, FALSE);
+            pane->curr_url = step_slice (pane, FALSE);
+        }
+        schedule_pane (pane, 0);
+    }
+}
+
+/*
+ * ee_tile_grid_set_paused: stop or restart cycling.  panes keep showing
+ *   their current URL while the grid is paused.
+ */
+void
+ee_tile_grid_set_paused (EETileGrid *grid, gboolean paused)
+{
+    EETilePane *pane;
+    guint i;
+
+    grid->paused = paused;
+    for (i = 0; i < grid->panes->len; i++) {
+        pane = g_ptr_array_index (grid->panes, i);
+        if (paused && pane->timeout_id > 0) {
+            ee_scheduler_remove (grid->scheduler, pane->timeout_id);
+            pane->timeout_id = 0;
+        }
+        else if (!paused && pane->timeout_id == 0)
+            schedule_pane (pane, get_dwell (pane) * 1000);
+    }
+}
+
+/*
+ * ee_tile_grid_free: free all memory associated with the grid.  the
+ *   webviews themselves are destroyed along with the table.
+ */
+void
+ee_tile_grid_free (EETileGrid *grid)
+{
+    EETilePane *pane;
+    guint i;
+
+    for (i = 0; i < grid->panes->len; i++) {
+        pane = g_ptr_array_index (grid->panes, i);
+        if (pane->timeout_id > 0)
+            ee_scheduler_remove (grid->scheduler, pane->timeout_id);
+        ee_playlist_remove_cursor (grid->settings->urls, &pane->curr_url);
+        g_slice_free (EETilePane, pane);
+    }
+    g_ptr_array_free (grid->panes, TRUE);
+    g_free (grid);
+}
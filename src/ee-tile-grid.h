@@ -0,0 +1,45 @@
+#ifndef EE_TILE_GRID_H
+#define EE_TILE_GRID_H
+
+#include <gtk/gtk.h>
+#include <webkit/webkit.h>
+#include <ee-settings.h>
+#include <ee-scheduler.h>
+
+typedef struct _EETileGrid EETileGrid;
+
+typedef struct {
+    EETileGrid *grid;
+    WebKitWebView *webview;
+    GtkWidget *page;
+    guint slot;
+    gint curr_url;
+    guint timeout_id;
+} EETilePane;
+
+typedef void (*EETileGridSetupFunc) (WebKitWebView *webview, gpointer data);
+typedef void (*EETileGridLoadFunc) (WebKitWebView *webview, EEUrl *url, gpointer data);
+
+struct _EETileGrid {
+    EESettings *settings;
+    EEScheduler *scheduler;
+    GtkTable *table;
+    GPtrArray *panes;
+    guint partition;
+    guint partitions;
+    gint64 next_load;
+    gboolean paused;
+    EETileGridLoadFunc load_func;
+    gpointer data;
+};
+
+EETileGrid *ee_tile_grid_new (EESettings *settings, EEScheduler *scheduler, guint rows, guint columns,
+                              WebKitWebSettings *websettings, EETileGridSetupFunc setup_func,
+                              EETileGridLoadFunc load_func, gpointer data);
+GtkWidget *ee_tile_grid_get_widget (EETileGrid *grid);
+void ee_tile_grid_set_partition (EETileGrid *grid, guint partition, guint partitions);
+void ee_tile_grid_step (EETileGrid *grid, gboolean forward);
+void ee_tile_grid_set_paused (EETileGrid *grid, gboolean paused);
+void ee_tile_grid_free (EETileGrid *grid);
+
+#endif
@@ -0,0 +1,243 @@
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <glib.h>
+#include <ee-trace.h>
+
+typedef struct {
+    const gchar *cat;
+    const gchar *name;
+    GThread *thread;
+    gint64 ts;
+    gchar phase;
+    gchar arg[EE_TRACE_ARG_MAX];
+} EETraceEvent;
+
+gboolean ee_trace_enabled = FALSE;
+
+/* the ring buffer, allocated once by ee_trace_start.  capacity is a power
+ * of two, so the slot is the event number masked. */
+static EETraceEvent *events = NULL;
+static guint capacity = 0;
+static volatile gint next_event = 0;
+static gint64 start_time = 0;
+static GThread *main_thread = NULL;
+static gchar *trace_path = NULL;
+
+/* SIGUSR2 is turned into a byte on this pipe, so that the dump runs on the
+ * main loop rather than in the signal handler */
+static gint signal_pipe[2] = { -1, -1 };
+static guint signal_id = 0;
+
+/*
+ * ee_trace_record: record an event in the ring buffer.  name and cat must
+ *   be static strings, arg is copied and may be NULL.  slots are claimed
+ *   atomically, so this is safe to call from any thread.
+ */
+void
+ee_trace_record (const gchar *cat, const gchar *name, const gchar *arg, gchar phase)
+{
+    EETraceEvent *event;
+    guint n;
+
+    n = (guint) g_atomic_int_exchange_and_add (&next_event, 1);
+    event = &events[n & (capacity - 1)];
+    event->cat = cat;
+    event->name = name;
+    event->thread = g_thread_self ();
+    event->ts = g_get_monotonic_time () - start_time;
+    event->phase = phase;
+    if (arg)
+        g_strlcpy (event->arg, arg, sizeof (event->arg));
+    else
+        event->arg[0] = '\0';
+}
+
+/*
+ * append_escaped: append s as a JSON string.
+ */
+static void
+append_escaped (GString *out, const gchar *s)
+{
+    g_string_append_c (out, '"');
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\')
+            g_string_append_printf (out, "\\%c", *s);
+        else if ((guchar) *s < 0x20)
+            g_string_append_printf (out, "\\u%04x", (guchar) *s);
+        else
+            g_string_append_c (out, *s);
+    }
+    g_string_append_c (out, '"');
+}
+
+/*
+ * ee_trace_dump: write the events in the ring buffer to the trace file, in
+ *   the Chrome trace event format, oldest first.  threads are numbered in
+ *   the order they appear, the main thread is always thread 1.  events
+ *   being recorded by another thread while dumping may come out torn.
+ *   returns FALSE if the trace couldn't be written.
+ */
+gboolean
+ee_trace_dump (void)
+{
+    GString *out;
+    GPtrArray *threads;
+    GError *error = NULL;
+    EETraceEvent *event;
+    guint n, first, last, tid;
+    gint pid = getpid ();
+    gboolean written, comma = FALSE;
+
+    if (!ee_trace_enabled)
+        return FALSE;
+    last = (guint) g_atomic_int_get (&next_event);
+    first = last > capacity ? last - capacity : 0;
+    threads = g_ptr_array_new ();
+    g_ptr_array_add (threads, main_thread);
+    out = g_string_sized_new ((last - first) * 128 + 64);
+    g_string_append (out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    for (n = first; n != last; n++) {
+        event = &events[n & (capacity - 1)];
+        if (event->name == NULL)
+            continue;
+        for (tid = 0; tid < threads->len; tid++)
+            if (g_ptr_array_index (threads, tid) == event->thread)
+                break;
+        if (tid == threads->len)
+            g_ptr_array_add (threads, event->thread);
+        if (comma)
+            g_string_append_c (out, ',');
+        comma = TRUE;
+        g_string_append (out, "\n{\"name\":");
+        append_escaped (out, event->name);
+        g_string_append (out, ",\"cat\":");
+        append_escaped (out, event->cat);
+        g_string_append_printf (out, ",\"ph\":\"%c\",\"ts\":%" G_GINT64_FORMAT ",\"pid\":%d,\"tid\":%u",
+            event->phase, event->ts, pid, tid + 1);
+        if (event->phase == 'i')
+            g_string_append (out, ",\"s\":\"t\"");
+        if (event->arg[0]) {
+            g_string_append (out, ",\"args\":{\"arg\":");
+            append_escaped (out, event->arg);
+            g_string_append_c (out, '}');
+        }
+        g_string_append_c (out, '}');
+    }
+    g_string_append (out, "\n]}\n");
+    g_ptr_array_free (threads, TRUE);
+
+    written = g_file_set_contents (trace_path, out->str, out->len, &error);
+    if (written)
+        g_debug ("wrote %u trace events to %s", last - first, trace_path);
+    else {
+        g_warning ("failed to write trace: %s", error->message);
+        g_error_free (error);
+    }
+    g_string_free (out, TRUE);
+    return written;
+}
+
+/*
+ * on_signal: SIGUSR2 handler, wakes up on_signal_pipe.  only async signal
+ *   safe calls are allowed here.
+ */
+static void
+on_signal (int signum)
+{
+    gint saved_errno = errno;
+    char c = 0;
+    ssize_t n;
+
+    /* if the pipe is full, a dump is already pending */
+    n = write (signal_pipe[1], &c, 1);
+    (void) n;
+    errno = saved_errno;
+}
+
+/*
+ * on_signal_pipe: dump the trace on the main loop after SIGUSR2.
+ */
+static gboolean
+on_signal_pipe (GIOChannel *        channel,
+                GIOCondition        condition,
+                gpointer            data)
+{
+    char buf[16];
+
+    while (read (signal_pipe[0], buf, sizeof (buf)) > 0)
+        ;
+    ee_trace_dump ();
+    return TRUE;
+}
+
+/*
+ * ee_trace_start: start recording trace events into a ring buffer holding
+ *   the last capacity events, rounded up to a power of two, or
+ *   EE_TRACE_EVENTS if capacity is 0.  the buffer is written to path on
+ *   SIGUSR2, and by ee_trace_stop.  must be called from the main thread
+ *   before any other thread is started.
+ */
+void
+ee_trace_start (const gchar *path, guint size)
+{
+    GIOChannel *channel;
+    struct sigaction action;
+
+    if (ee_trace_enabled)
+        return;
+    capacity = 1;
+    while (capacity < (size > 0 ? size : EE_TRACE_EVENTS))
+        capacity <<= 1;
+    events = g_new0 (EETraceEvent, capacity);
+    trace_path = g_strdup (path);
+    start_time = g_get_monotonic_time ();
+    main_thread = g_thread_self ();
+
+    if (pipe (signal_pipe) < 0) {
+        g_warning ("failed to create trace signal pipe: %s", g_strerror (errno));
+        signal_pipe[0] = signal_pipe[1] = -1;
+    }
+    else {
+        fcntl (signal_pipe[0], F_SETFL, O_NONBLOCK);
+        fcntl (signal_pipe[1], F_SETFL, O_NONBLOCK);
+        channel = g_io_channel_unix_new (signal_pipe[0]);
+        signal_id = g_io_add_watch (channel, G_IO_IN, on_signal_pipe, NULL);
+        g_io_channel_unref (channel);
+        memset (&action, 0, sizeof (action));
+        action.sa_handler = on_signal;
+        action.sa_flags = SA_RESTART;
+        sigemptyset (&action.sa_mask);
+        sigaction (SIGUSR2, &action, NULL);
+    }
+    ee_trace_enabled = TRUE;
+    g_debug ("tracing %u events to %s, send SIGUSR2 to write them", capacity, path);
+}
+
+/*
+ * ee_trace_stop: write the trace and stop tracing.  events recorded by
+ *   other threads after this are dropped, so stop those threads first.
+ */
+void
+ee_trace_stop (void)
+{
+    if (!ee_trace_enabled)
+        return;
+    ee_trace_dump ();
+    ee_trace_enabled = FALSE;
+    signal (SIGUSR2, SIG_DFL);
+    if (signal_id > 0)
+        g_source_remove (signal_id);
+    signal_id = 0;
+    if (signal_pipe[0] >= 0) {
+        close (signal_pipe[0]);
+        close (signal_pipe[1]);
+    }
+    signal_pipe[0] = signal_pipe[1] = -1;
+    g_free (trace_path);
+    trace_path = NULL;
+    g_free (events);
+    events = NULL;
+}
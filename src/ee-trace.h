@@ -0,0 +1,35 @@
+#ifndef EE_TRACE_H
+#define EE_TRACE_H
+
+#include <glib.h>
+
+/* the default number of events kept, older events are overwritten */
+#define EE_TRACE_EVENTS 16384
+
+/* the longest event argument kept, longer arguments are truncated */
+#define EE_TRACE_ARG_MAX 96
+
+/* TRUE once ee_trace_start has been called.  the macros below test this
+ * before doing anything else, so tracing costs a load and a branch when it
+ * is disabled. */
+extern gboolean ee_trace_enabled;
+
+#define EE_TRACE_BEGIN(cat, name, arg) G_STMT_START { \
+    if (G_UNLIKELY (ee_trace_enabled)) \
+        ee_trace_record ((cat), (name), (arg), 'B'); \
+} G_STMT_END
+#define EE_TRACE_END(cat, name) G_STMT_START { \
+    if (G_UNLIKELY (ee_trace_enabled)) \
+        ee_trace_record ((cat), (name), NULL, 'E'); \
+} G_STMT_END
+#define EE_TRACE_INSTANT(cat, name, arg) G_STMT_START { \
+    if (G_UNLIKELY (ee_trace_enabled)) \
+        ee_trace_record ((cat), (name), (arg), 'i'); \
+} G_STMT_END
+
+void ee_trace_start (const gchar *path, guint capacity);
+void ee_trace_record (const gchar *cat, const gchar *name, const gchar *arg, gchar phase);
+gboolean ee_trace_dump (void);
+void ee_trace_stop (void);
+
+#endif
@@ -2,8 +2,21 @@
 #include <gtk/gtk.h>
 #include <libsoup/soup.h>
 #include <ee-settings.h>
+#include <ee-import.h>
+#include <ee-trace.h>
 
-enum { URL_COLUMN, USER_COLUMN, PASSWORD_COLUMN, N_COLUMNS };
+/* the attributes column isn't shown, it carries all of the attributes of
+ * an entry along when it is dragged to a new position */
+enum { URL_COLUMN, USER_COLUMN, PASSWORD_COLUMN, ATTRIBUTES_COLUMN, N_COLUMNS };
+
+/* response sent to the import dialog once the import thread has finished */
+#define IMPORT_RESPONSE_DONE 1
+
+typedef struct {
+    GtkDialog *dialog;
+    GtkProgressBar *progress;
+    EEImport *import;
+} ImportState;
 
 /*
  * 
@@ -15,23 +28,33 @@ on_row_inserted (GtkTreeModel *         model,
                  EESettings *           settings)
 {
     gint *indices;
-    gchar *url, *username, *password;
+    gchar *url, *username, *password, *attrs;
     SoupURI *uri;
 
     indices = gtk_tree_path_get_indices (path);
     if (!indices)
         return;
     gtk_tree_model_get (model, iter, URL_COLUMN, &url,
-        USER_COLUMN, &username, PASSWORD_COLUMN, &password, -1);
+        USER_COLUMN, &username, PASSWORD_COLUMN, &password,
+        ATTRIBUTES_COLUMN, &attrs, -1);
     uri = soup_uri_new (url);
     if (username && username[0] != '\0')
         soup_uri_set_user (uri, username);
     if (password && password[0] != '\0')
     soup_uri_set_password (uri, password);
-    if (ee_settings_insert_url (settings, uri, indices[0]))
+    /* the row is already in the store, so the playlist has to follow it
+     * even if it is a duplicate */
+    if (ee_settings_insert_url_with_policy (settings, uri, indices[0], EE_DUPLICATES_ALLOW)) {
+        if (attrs && attrs[0] != '\0')
+            ee_settings_set_url_attributes (settings, indices[0], attrs);
         g_debug ("inserted row at position %i", indices[0]);
+    }
     soup_uri_free (uri);
-    ee_settings_save(settings);
+    g_free (url);
+    g_free (username);
+    g_free (password);
+    g_free (attrs);
+    ee_settings_changed (settings, EE_SETTINGS_URLS);
 }
 
 /*
@@ -53,7 +76,30 @@ on_row_deleted (GtkTreeModel *          model,
     }
     ee_settings_remove_url (settings, (guint) indices[0]);
     g_debug ("deleted row at position %i", (guint) indices[0]);
-    ee_settings_save(settings);
+    ee_settings_changed (settings, EE_SETTINGS_URLS);
+}
+
+/*
+ * on_drag_begin: reordering a row deletes it and inserts it somewhere else,
+ *   so treat the whole drag as one batch of changes.
+ */
+static void
+on_drag_begin (GtkWidget *              widget,
+               GdkDragContext *         context,
+               EESettings *             settings)
+{
+    ee_settings_begin_batch (settings);
+}
+
+/*
+ * on_drag_end: save the changes made during the drag.
+ */
+static void
+on_drag_end (GtkWidget *                widget,
+             GdkDragContext *           context,
+             EESettings *               settings)
+{
+    ee_settings_commit_batch (settings);
 }
 
 /*
@@ -130,10 +176,31 @@ on_clicked_add (GtkToolButton *         button,
         const gchar *url = gtk_entry_get_text (GTK_ENTRY (url_entry));
         const gchar *user = gtk_entry_get_text (GTK_ENTRY (user_entry));
         const gchar *pass = gtk_entry_get_text (GTK_ENTRY (pass_entry));
+
+        EESettings *settings;
         SoupURI *uri;
+        gint existing;
 
+        /* if the URL is already in the list, then select it instead */
+        settings = (EESettings *) g_object_get_data (G_OBJECT (tree_view), "ee-settings");
+        existing = ee_settings_find_url (settings, url);
         uri = soup_uri_new (url);
-        if (uri && SOUP_URI_VALID_FOR_HTTP (uri)) {
+        if (existing >= 0 && settings->duplicate_urls != EE_DUPLICATES_ALLOW) {
+            GtkTreePath *path;
+            GtkWidget *alert;
+
+            path = gtk_tree_path_new_from_indices (existing, -1);
+            gtk_tree_selection_select_path (gtk_tree_view_get_selection (tree_view), path);
+            gtk_tree_view_scroll_to_cell (tree_view, path, NULL, FALSE, 0.0, 0.0);
+            gtk_tree_path_free (path);
+            alert = gtk_message_dialog_new (NULL, GTK_DIALOG_DESTROY_WITH_PARENT,
+                GTK_MESSAGE_INFO, GTK_BUTTONS_CLOSE, "URL is already in the list");
+            gtk_dialog_run (GTK_DIALOG (alert));
+            gtk_widget_destroy (alert);
+            if (uri)
+                soup_uri_free (uri);
+        }
+        else if (uri && SOUP_URI_VALID_FOR_HTTP (uri)) {
             GtkTreeModel *model;
             GtkTreeIter iter;
 
@@ -160,6 +227,187 @@ on_clicked_add (GtkToolButton *         button,
     gtk_widget_destroy (dialog);
 }
 
+/*
+ * on_import_progress: update the progress bar while the import thread is
+ *   running, and end the dialog's run loop once it has finished.
+ */
+static gboolean
+on_import_progress (ImportState *state)
+{
+    gtk_progress_bar_set_fraction (state->progress, ee_import_get_progress (state->import));
+    if (!ee_import_is_done (state->import))
+        return TRUE;
+    gtk_dialog_response (state->dialog, IMPORT_RESPONSE_DONE);
+    return FALSE;
+}
+
+/*
+ * add_imported_urls: append the imported URLs to the store.  the store is
+ *   detached from the tree view while it is filled, and the resulting
+ *   playlist edits are saved as one batch.
+ */
+static void
+add_imported_urls (GtkTreeView *tree_view, EESettings *settings, EEImport *import)
+{
+    GtkTreeModel *model;
+    GtkTreeIter iter;
+    EEImportEntry *entry;
+    guint i;
+
+    model = g_object_ref (gtk_tree_view_get_model (tree_view));
+    gtk_tree_view_set_model (tree_view, NULL);
+    ee_settings_begin_batch (settings);
+    for (i = 0; i < import->entries->len; i++) {
+        entry = (EEImportEntry *) g_ptr_array_index (import->entries, i);
+        gtk_list_store_append (GTK_LIST_STORE (model), &iter);
+        gtk_list_store_set (GTK_LIST_STORE (model), &iter, URL_COLUMN, entry->url,
+            USER_COLUMN, entry->user, PASSWORD_COLUMN, entry->password, -1);
+    }
+    ee_settings_commit_batch (settings);
+    gtk_tree_view_set_model (tree_view, model);
+    g_object_unref (model);
+}
+
+/*
+ * on_clicked_import: import a block of URLs, either pasted into the dialog
+ *   or read from a file.  the URLs are parsed and validated on a separate
+ *   thread, so the main loop keeps running while a large list is imported.
+ */
+static void
+on_clicked_import (GtkToolButton *      button,
+                   GtkTreeView *        tree_view)
+{
+    EESettings *settings;
+    GtkWidget *dialog;
+    GtkWidget *align;
+    GtkWidget *vbox;
+    GtkWidget *label;
+    GtkWidget *scrolled;
+    GtkWidget *text_view;
+    GtkWidget *chooser;
+    GtkWidget *progress;
+    GtkWidget *alert;
+    GtkTextBuffer *buffer;
+    GtkTextIter start, end;
+    GtkTreeModel *model;
+    GtkTreeIter iter;
+    GPtrArray *existing;
+    ImportState state;
+    gchar *text, *filename, *url;
+
+    g_debug ("---- IMPORT URLS ----");
+    settings = (EESettings *) g_object_get_data (G_OBJECT (tree_view), "ee-settings");
+
+    /* create the toplevel dialog window */
+    dialog = gtk_dialog_new_with_buttons ("Import URLs ...",
+        NULL, GTK_DIALOG_DESTROY_WITH_PARENT, GTK_STOCK_CANCEL,
+        GTK_RESPONSE_CANCEL, GTK_STOCK_OK, GTK_RESPONSE_OK, NULL);
+    gtk_dialog_set_default_response (GTK_DIALOG (dialog), GTK_RESPONSE_OK);
+    gtk_window_set_default_size (GTK_WINDOW (dialog), 480, 360);
+
+    /* create 12px padding */
+    align = gtk_alignment_new (0.5, 0.5, 1.0, 1.0);
+    gtk_alignment_set_padding (GTK_ALIGNMENT (align), 12, 12, 12, 12);
+    gtk_box_pack_start (GTK_BOX (GTK_DIALOG(dialog)->vbox), align, TRUE, TRUE, 0);
+
+    vbox = gtk_vbox_new (FALSE, 6);
+    gtk_container_add (GTK_CONTAINER (align), vbox);
+
+    /* add the text view for pasting URLs */
+    label = gtk_label_new (NULL);
+    gtk_label_set_markup (GTK_LABEL (label), "<b>URLs</b> (one per line)");
+    gtk_misc_set_alignment (GTK_MISC (label), 0.0, 0.5);
+    gtk_box_pack_start (GTK_BOX (vbox), label, FALSE, FALSE, 0);
+    scrolled = gtk_scrolled_window_new (NULL, NULL);
+    gtk_scrolled_window_set_policy (GTK_SCROLLED_WINDOW (scrolled),
+        GTK_POLICY_AUTOMATIC, GTK_POLICY_AUTOMATIC);
+    gtk_box_pack_start (GTK_BOX (vbox), scrolled, TRUE, TRUE, 0);
+    text_view = gtk_text_view_new ();
+    gtk_container_add (GTK_CONTAINER (scrolled), text_view);
+
+    /* add the file chooser, which takes precedence over pasted URLs */
+    label = gtk_label_new (NULL);
+    gtk_label_set_markup (GTK_LABEL (label), "<b>File</b> (optional)");
+    gtk_misc_set_alignment (GTK_MISC (label), 0.0, 0.5);
+    gtk_box_pack_start (GTK_BOX (vbox), label, FALSE, FALSE, 0);
+    chooser = gtk_file_chooser_button_new ("Import URLs from file",
+        GTK_FILE_CHOOSER_ACTION_OPEN);
+    gtk_box_pack_start (GTK_BOX (vbox), chooser, FALSE, FALSE, 0);
+
+    progress = gtk_progress_bar_new ();
+    gtk_box_pack_start (GTK_BOX (vbox), progress, FALSE, FALSE, 0);
+
+    /* run the dialog */
+    gtk_widget_show_all (dialog);
+    if (gtk_dialog_run (GTK_DIALOG (dialog)) != GTK_RESPONSE_OK) {
+        gtk_widget_destroy (dialog);
+        return;
+    }
+    buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (text_view));
+    gtk_text_buffer_get_bounds (buffer, &start, &end);
+    text = gtk_text_buffer_get_text (buffer, &start, &end, FALSE);
+    filename = gtk_file_chooser_get_filename (GTK_FILE_CHOOSER (chooser));
+
+    /* copy the URLs already in the store, so duplicates can be dropped */
+    existing = g_ptr_array_new ();
+    model = gtk_tree_view_get_model (tree_view);
+    if (gtk_tree_model_get_iter_first (model, &iter)) {
+        do {
+            gtk_tree_model_get (model, &iter, URL_COLUMN, &url, -1);
+            if (url)
+                g_ptr_array_add (existing, url);
+        } while (gtk_tree_model_iter_next (model, &iter));
+    }
+
+    /* start the import thread */
+    if (filename) {
+        g_free (text);
+        text = NULL;
+    }
+    state.import = ee_import_start (filename, text, existing);
+    g_free (filename);
+    if (state.import == NULL) {
+        gtk_widget_destroy (dialog);
+        return;
+    }
+
+    /* wait for the import to finish, cancelling it if the dialog is closed */
+    gtk_widget_set_sensitive (text_view, FALSE);
+    gtk_widget_set_sensitive (chooser, FALSE);
+    gtk_dialog_set_response_sensitive (GTK_DIALOG (dialog), GTK_RESPONSE_OK, FALSE);
+    state.dialog = GTK_DIALOG (dialog);
+    state.progress = GTK_PROGRESS_BAR (progress);
+    /* the timeout removes itself when it sends IMPORT_RESPONSE_DONE */
+    g_timeout_add (100, (GSourceFunc) on_import_progress, &state);
+    EE_TRACE_BEGIN ("dialog", "import", NULL);
+    while (gtk_dialog_run (GTK_DIALOG (dialog)) != IMPORT_RESPONSE_DONE)
+        ee_import_cancel (state.import);
+    ee_import_finish (state.import);
+    EE_TRACE_END ("dialog", "import");
+    gtk_widget_destroy (dialog);
+
+    /* add the results to the store and tell the user how it went */
+    if (state.import->cancelled)
+        g_debug ("import was cancelled");
+    else if (state.import->error) {
+        alert = gtk_message_dialog_new (NULL, GTK_DIALOG_DESTROY_WITH_PARENT,
+            GTK_MESSAGE_ERROR, GTK_BUTTONS_CLOSE, "Failed to import URLs: %s",
+            state.import->error);
+        gtk_dialog_run (GTK_DIALOG (alert));
+        gtk_widget_destroy (alert);
+    }
+    else {
+        add_imported_urls (tree_view, settings, state.import);
+        alert = gtk_message_dialog_new (NULL, GTK_DIALOG_DESTROY_WITH_PARENT,
+            GTK_MESSAGE_INFO, GTK_BUTTONS_CLOSE,
+            "Imported %u URLs (%u invalid, %u duplicates skipped)",
+            state.import->entries->len, state.import->ninvalid, state.import->nduplicate);
+        gtk_dialog_run (GTK_DIALOG (alert));
+        gtk_widget_destroy (alert);
+    }
+    ee_import_free (state.import);
+}
+
 /*
  *
  */
@@ -190,13 +438,14 @@ ee_url_manager_new (EESettings *settings)
     GtkWidget *frame;
     GtkWidget *vbox;
     GtkListStore *store;
-    GList *curr;
+    guint i;
     GtkWidget *tree_view;
     GtkCellRenderer *renderer;
     GtkTreeViewColumn *column;
     GtkWidget *toolbar;
     GtkToolItem *add;
     GtkToolItem *remove;
+    GtkToolItem *import;
 
     /* create the toplevel dialog window */
     dialog = gtk_dialog_new_with_buttons ("URL Manager",
@@ -217,28 +466,27 @@ ee_url_manager_new (EESettings *settings)
     gtk_container_add (GTK_CONTAINER (frame), vbox);
 
     /* create the URL list store */
-    store = gtk_list_store_new (N_COLUMNS, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING);
+    store = gtk_list_store_new (N_COLUMNS, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING,
+        G_TYPE_STRING);
 
     /* load the list store from settings->urls */
-    for (curr = settings->urls; curr; curr = g_list_next (curr)) {
-        SoupURI *uri;
-        gchar *url, *user, *password;
+    for (i = 0; i < ee_playlist_length (settings->urls); i++) {
+        EEUrl *url;
         GtkTreeIter iter;
+        gchar attrs[EE_URL_ATTRIBUTES_MAX];
 
-        uri = (SoupURI *) curr->data;
-        url = soup_uri_to_string (uri, FALSE);
-        user = uri->user ? g_strdup (uri->user) : NULL;
-        password = uri->password ? g_strdup (uri->password) : NULL;
-
+        /* show invalid URLs as they were written, so they can be fixed */
+        url = ee_playlist_get_parsed (settings->urls, i);
         gtk_list_store_append (GTK_LIST_STORE (store), &iter);
-        gtk_list_store_set (GTK_LIST_STORE (store), &iter, URL_COLUMN, url,
-            USER_COLUMN, user, PASSWORD_COLUMN, password, -1);
-        if (url)
-            g_free (url);
-        if (user)
-            g_free (user);
-        if (password)
-            g_free (password);
+        if (url) {
+            ee_url_format_attributes (url, attrs, sizeof (attrs));
+            gtk_list_store_set (GTK_LIST_STORE (store), &iter, URL_COLUMN, url->display,
+                USER_COLUMN, url->user, PASSWORD_COLUMN, url->password,
+                ATTRIBUTES_COLUMN, attrs, -1);
+        }
+        else
+            gtk_list_store_set (GTK_LIST_STORE (store), &iter, URL_COLUMN,
+                ee_playlist_get (settings->urls, i)->text, -1);
     }
 
     /*
@@ -254,6 +502,11 @@ ee_url_manager_new (EESettings *settings)
     /* create the tree view and pack it into the vbox */
     tree_view = gtk_tree_view_new_with_model (GTK_TREE_MODEL (store));
     gtk_tree_view_set_reorderable (GTK_TREE_VIEW (tree_view), TRUE);
+    g_object_set_data (G_OBJECT (tree_view), "ee-settings", settings);
+    g_signal_connect (tree_view, "drag-begin",
+        G_CALLBACK (on_drag_begin), settings);
+    g_signal_connect (tree_view, "drag-end",
+        G_CALLBACK (on_drag_end), settings);
     gtk_box_pack_start (GTK_BOX (vbox), tree_view, TRUE, TRUE, 0);
 
     renderer = gtk_cell_renderer_text_new ();
@@ -277,6 +530,11 @@ ee_url_manager_new (EESettings *settings)
     g_signal_connect (remove, "clicked",
         G_CALLBACK (on_clicked_remove), tree_view);
     gtk_toolbar_insert (GTK_TOOLBAR (toolbar), remove, -1);
+    import = gtk_tool_button_new_from_stock (GTK_STOCK_OPEN);
+    gtk_tool_item_set_tooltip_text (import, "Import URLs");
+    g_signal_connect (import, "clicked",
+        G_CALLBACK (on_clicked_import), tree_view);
+    gtk_toolbar_insert (GTK_TOOLBAR (toolbar), import, -1);
  
     gtk_widget_show_all (dialog);
     
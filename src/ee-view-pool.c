@@ -0,0 +1,277 @@
+#include <stdio.h>
+#include <unistd.h>
+#include <glib.h>
+#include <gtk/gtk.h>
+#include <webkit/webkit.h>
+#include <ee-view-pool.h>
+#include <ee-load-log.h>
+
+/*
+ * ee_view_pool_get_resident_size: returns the resident set size of the
+ *   process in kilobytes, or 0 if it couldn't be determined.
+ */
+gulong
+ee_view_pool_get_resident_size (void)
+{
+    gchar *data = NULL;
+    gulong pages = 0;
+
+    if (!g_file_get_contents ("/proc/self/statm", &data, NULL, NULL))
+        return 0;
+    if (sscanf (data, "%*u %lu", &pages) != 1)
+        pages = 0;
+    g_free (data);
+    return pages * (sysconf (_SC_PAGESIZE) / 1024);
+}
+
+/*
+ * on_load_finished: mark the view as finished loading.  this handler is
+ *   connected before the setup function is called, so it runs before any
+ *   handlers the pool owner connects.
+ */
+static void
+on_load_finished (WebKitWebView *       webview,
+                  WebKitWebFrame *      frame,
+                  EEPoolView *          view)
+{
+    view->finished = TRUE;
+}
+
+/*
+ * create_view: create a new webview inside a scrolled window, and append
+ *   it to the pool notebook.  the new view is the least recently used.
+ */
+static EEPoolView *
+create_view (EEViewPool *pool)
+{
+    EEPoolView *view;
+    GtkWidget *webview;
+    GtkWidget *sw;
+
+    webview = webkit_web_view_new ();
+    webkit_web_view_set_settings (WEBKIT_WEB_VIEW (webview), pool->websettings);
+    webkit_web_view_set_full_content_zoom(WEBKIT_WEB_VIEW (webview), TRUE);
+
+    /* put the webview in a scrolled window and put that in the notebook */
+    sw = gtk_scrolled_window_new (NULL, NULL);
+    gtk_scrolled_window_set_policy(GTK_SCROLLED_WINDOW (sw),
+        GTK_POLICY_AUTOMATIC, GTK_POLICY_AUTOMATIC);
+    gtk_container_add(GTK_CONTAINER (sw), webview);
+    gtk_widget_show_all (sw);
+    gtk_notebook_append_page (pool->notebook, sw, NULL);
+
+    view = g_slice_new0 (EEPoolView);
+    view->webview = WEBKIT_WEB_VIEW (webview);
+    view->page = sw;
+    view->url = NULL;
+    view->finished = FALSE;
+    g_object_set_data (G_OBJECT (webview), "ee-pool-view", view);
+    g_signal_connect (webview, "load-finished",
+        G_CALLBACK (on_load_finished), view);
+    g_queue_push_tail (&pool->lru, view);
+
+    if (pool->setup_func)
+        pool->setup_func (view->webview, pool->setup_data);
+    g_debug ("created view %u of %u", pool->lru.length, pool->max_views);
+    return view;
+}
+
+/*
+ * destroy_view: remove the view from the pool and destroy the webview.
+ */
+static void
+destroy_view (EEViewPool *pool, EEPoolView *view)
+{
+    g_queue_remove (&pool->lru, view);
+    gtk_notebook_remove_page (pool->notebook,
+        gtk_notebook_page_num (pool->notebook, view->page));
+    g_free (view->url);
+    g_slice_free (EEPoolView, view);
+}
+
+/*
+ * ee_view_pool_new: create a pool holding at most max_views webviews.  if
+ *   memory_budget is non-zero, then views are evicted when the resident set
+ *   size of the process exceeds memory_budget megabytes.  all views share
+ *   the websettings object, and setup_func is called for each new webview
+ *   so the caller can connect its signal handlers.
+ */
+EEViewPool *
+ee_view_pool_new (guint                 max_views,
+                  guint                 memory_budget,
+                  WebKitWebSettings *   websettings,
+                  EEViewPoolSetupFunc   setup_func,
+                  gpointer              setup_data)
+{
+    EEViewPool *pool;
+    GtkWidget *notebook;
+
+    pool = g_new0 (EEViewPool, 1);
+    pool->max_views = max_views > 0 ? max_views : 1;
+    pool->memory_budget = memory_budget;
+    pool->websettings = g_object_ref (websettings);
+    pool->setup_func = setup_func;
+    pool->setup_data = setup_data;
+    g_queue_init (&pool->lru);
+
+    /*
+     * the tabs are never shown, switching views is done by changing the
+     * current page.  hidden pages are still allocated, so a page loaded
+     * in the background is fully laid out by the time it is shown.
+     */
+    notebook = gtk_notebook_new ();
+    gtk_notebook_set_show_tabs (GTK_NOTEBOOK (notebook), FALSE);
+    gtk_notebook_set_show_border (GTK_NOTEBOOK (notebook), FALSE);
+    pool->notebook = GTK_NOTEBOOK (notebook);
+
+    /* there is always at least one view, which is the visible one */
+    create_view (pool);
+    return pool;
+}
+
+/*
+ * ee_view_pool_get_widget: returns the widget to pack into the window.
+ */
+GtkWidget *
+ee_view_pool_get_widget (EEViewPool *pool)
+{
+    return GTK_WIDGET (pool->notebook);
+}
+
+/*
+ * ee_view_pool_get_view: returns the pool view which owns webview.
+ */
+EEPoolView *
+ee_view_pool_get_view (WebKitWebView *webview)
+{
+    return (EEPoolView *) g_object_get_data (G_OBJECT (webview), "ee-pool-view");
+}
+
+/*
+ * ee_view_pool_lookup: returns the view retaining url, or NULL if no view
+ *   has that URL loaded.
+ */
+EEPoolView *
+ee_view_pool_lookup (EEViewPool *pool, const gchar *url)
+{
+    GList *item;
+    EEPoolView *view;
+
+    for (item = pool->lru.head; item; item = g_list_next (item)) {
+        view = (EEPoolView *) item->data;
+        if (view->url && !g_strcmp0 (view->url, url))
+            return view;
+    }
+    return NULL;
+}
+
+/*
+ * ee_view_pool_acquire: returns a hidden view to load a new URL into.  if
+ *   the pool is not full, then a new view is created, otherwise the least
+ *   recently used view is recycled.  the most recently used view is the
+ *   visible one, and is never returned, so if the pool holds only a single
+ *   view then NULL is returned.
+ */
+EEPoolView *
+ee_view_pool_acquire (EEViewPool *pool)
+{
+    EEPoolView *view;
+
+    if (pool->lru.length < pool->max_views)
+        return create_view (pool);
+    if (pool->lru.length < 2)
+        return NULL;
+    view = (EEPoolView *) g_queue_peek_tail (&pool->lru);
+    if (view->url)
+        g_debug ("evicting least recently used view for %s", view->url);
+    if (!view->finished)
+        ee_view_pool_stop (view, FALSE);
+    return view;
+}
+
+/*
+ * ee_view_pool_stop: abandon the load in progress in view.  stopping emits
+ *   load-finished, so the view is marked as failed first, which stops the
+ *   half loaded page being counted as a success or reused as a retained
+ *   page.  timed_out is TRUE if the load took longer than its timeout,
+ *   which is how the load log records it.
+ */
+void
+ee_view_pool_stop (EEPoolView *view, gboolean timed_out)
+{
+    view->failed = TRUE;
+    if (timed_out)
+        ee_load_log_set_timed_out (view->webview);
+    webkit_web_view_stop_loading (view->webview);
+}
+
+/*
+ * ee_view_pool_load: start loading url into the view.
+ */
+void
+ee_view_pool_load (EEViewPool *pool, EEPoolView *view, const gchar *url)
+{
+    if (view->url)
+        g_free (view->url);
+    view->url = g_strdup (url);
+    view->finished = FALSE;
+    view->failed = FALSE;
+    webkit_web_view_load_uri (view->webview, url);
+}
+
+/*
+ * ee_view_pool_show: make the view visible, and mark it as the most
+ *   recently used.
+ */
+void
+ee_view_pool_show (EEViewPool *pool, EEPoolView *view)
+{
+    gtk_notebook_set_current_page (pool->notebook,
+        gtk_notebook_page_num (pool->notebook, view->page));
+    g_queue_remove (&pool->lru, view);
+    g_queue_push_head (&pool->lru, view);
+    ee_view_pool_trim (pool);
+}
+
+/*
+ * ee_view_pool_trim: if the process is over its memory budget, then destroy
+ *   the least recently used hidden view.  memory isn't necessarily returned
+ *   to the system right away, so at most one view is destroyed per call;
+ *   measuring again straight away would see the old resident size and
+ *   destroy every hidden view.  a process which stays over budget loses
+ *   another view each time a view is shown.
+ */
+void
+ee_view_pool_trim (EEViewPool *pool)
+{
+    gulong rss;
+    EEPoolView *view;
+
+    if (pool->memory_budget == 0 || pool->lru.length < 2)
+        return;
+    rss = ee_view_pool_get_resident_size ();
+    if (rss <= (gulong) pool->memory_budget * 1024)
+        return;
+    view = (EEPoolView *) g_queue_peek_tail (&pool->lru);
+    g_debug ("resident size %lu kB exceeds budget of %u MB, destroying view for %s",
+        rss, pool->memory_budget, view->url ? view->url : "(none)");
+    destroy_view (pool, view);
+}
+
+/*
+ * ee_view_pool_free: free all memory associated with the pool.  the webviews
+ *   themselves are destroyed along with the notebook.
+ */
+void
+ee_view_pool_free (EEViewPool *pool)
+{
+    EEPoolView *view;
+
+    while ((view = (EEPoolView *) g_queue_pop_head (&pool->lru)) != NULL) {
+        g_object_set_data (G_OBJECT (view->webview), "ee-pool-view", NULL);
+        g_free (view->url);
+        g_slice_free (EEPoolView, view);
+    }
+    g_object_unref (pool->websettings);
+    g_free (pool);
+}
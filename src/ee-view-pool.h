@@ -0,0 +1,41 @@
+#ifndef EE_VIEW_POOL_H
+#define EE_VIEW_POOL_H
+
+#include <gtk/gtk.h>
+#include <webkit/webkit.h>
+
+typedef struct {
+    WebKitWebView *webview;
+    GtkWidget *page;
+    gchar *url;
+    gboolean finished;
+    gboolean failed;
+    guint refresh_id;
+} EEPoolView;
+
+typedef void (*EEViewPoolSetupFunc) (WebKitWebView *webview, gpointer data);
+
+typedef struct {
+    GtkNotebook *notebook;
+    WebKitWebSettings *websettings;
+    GQueue lru;
+    guint max_views;
+    guint memory_budget;
+    EEViewPoolSetupFunc setup_func;
+    gpointer setup_data;
+} EEViewPool;
+
+EEViewPool *ee_view_pool_new (guint max_views, guint memory_budget, WebKitWebSettings *websettings,
+                              EEViewPoolSetupFunc setup_func, gpointer setup_data);
+GtkWidget *ee_view_pool_get_widget (EEViewPool *pool);
+EEPoolView *ee_view_pool_get_view (WebKitWebView *webview);
+EEPoolView *ee_view_pool_lookup (EEViewPool *pool, const gchar *url);
+EEPoolView *ee_view_pool_acquire (EEViewPool *pool);
+void ee_view_pool_stop (EEPoolView *view, gboolean timed_out);
+void ee_view_pool_load (EEViewPool *pool, EEPoolView *view, const gchar *url);
+void ee_view_pool_show (EEViewPool *pool, EEPoolView *view);
+void ee_view_pool_trim (EEViewPool *pool);
+void ee_view_pool_free (EEViewPool *pool);
+gulong ee_view_pool_get_resident_size (void);
+
+#endif
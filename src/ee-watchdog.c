@@ -0,0 +1,179 @@
+#include <signal.h>
+#include <unistd.h>
+#include <string.h>
+#include <pthread.h>
+#ifdef HAVE_EXECINFO_H
+#include <execinfo.h>
+#endif
+#include <glib.h>
+#include <ee-watchdog.h>
+#include <ee-trace.h>
+
+/* the deepest main thread stack printed when the main loop stalls */
+#define EE_WATCHDOG_FRAMES 64
+
+/* upper bounds of the latency buckets in seconds */
+static const gdouble latency_bounds[EE_METRICS_BUCKETS - 1] = {
+    0.001, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 1.0, 5.0
+};
+
+static pthread_t main_thread;
+
+#ifdef HAVE_EXECINFO_H
+/*
+ * on_backtrace_signal: print the stack of the main thread, which the
+ *   watchdog thread interrupted with SIGUSR1.  backtrace_symbols_fd doesn't
+ *   allocate, so this is safe in a signal handler.
+ */
+static void
+on_backtrace_signal (int signum)
+{
+    void *frames[EE_WATCHDOG_FRAMES];
+    gint n;
+
+    n = backtrace (frames, EE_WATCHDOG_FRAMES);
+    backtrace_symbols_fd (frames, n, STDERR_FILENO);
+}
+#endif
+
+/*
+ * on_ping: runs on the main loop once it gets round to the watchdog's ping,
+ *   and records how long that took.
+ */
+static gboolean
+on_ping (EEWatchdog *watchdog)
+{
+    gint64 latency;
+    gboolean stalled;
+
+    g_mutex_lock (watchdog->lock);
+    latency = g_get_monotonic_time () - watchdog->ping_sent;
+    stalled = watchdog->stall_reported;
+    watchdog->stall_reported = FALSE;
+    watchdog->ping_id = 0;
+    g_mutex_unlock (watchdog->lock);
+
+    ee_histogram_observe (&watchdog->latency, latency / (gdouble) G_USEC_PER_SEC);
+    watchdog->max_latency = MAX (watchdog->max_latency, latency);
+    if (stalled) {
+        g_warning ("main loop recovered after stalling for %" G_GINT64_FORMAT " ms",
+            latency / 1000);
+        EE_TRACE_INSTANT ("watchdog", "stall", NULL);
+    }
+    return FALSE;
+}
+
+/*
+ * watchdog_thread: every interval, queue a ping on the main loop unless the
+ *   last one is still waiting.  if it has been waiting longer than the
+ *   threshold, then report the stall, once per stall.
+ */
+static gpointer
+watchdog_thread (EEWatchdog *watchdog)
+{
+    GTimeVal until;
+    gint64 waited;
+
+    g_mutex_lock (watchdog->lock);
+    while (!watchdog->stopping) {
+        if (watchdog->ping_id == 0) {
+            watchdog->ping_sent = g_get_monotonic_time ();
+            watchdog->ping_id = g_idle_add_full (G_PRIORITY_DEFAULT,
+                (GSourceFunc) on_ping, watchdog, NULL);
+        }
+        else if (!watchdog->stall_reported) {
+            waited = (g_get_monotonic_time () - watchdog->ping_sent) / 1000;
+            if (waited >= watchdog->threshold) {
+                watchdog->stall_reported = TRUE;
+                watchdog->stalls++;
+                g_warning ("main loop has been stalled for %" G_GINT64_FORMAT " ms", waited);
+#ifdef HAVE_EXECINFO_H
+                if (watchdog->capture_stack)
+                    pthread_kill (main_thread, SIGUSR1);
+#endif
+            }
+        }
+        g_get_current_time (&until);
+        g_time_val_add (&until, watchdog->interval * 1000);
+        g_cond_timed_wait (watchdog->cond, watchdog->lock, &until);
+    }
+    g_mutex_unlock (watchdog->lock);
+    return NULL;
+}
+
+/*
+ * ee_watchdog_new: start a thread which pings the main loop every interval
+ *   milliseconds, and warns when a ping waits more than threshold
+ *   milliseconds.  if capture_stack is TRUE, then the main thread's stack is
+ *   printed to stderr when it stalls.  must be called from the main thread.
+ *   returns NULL if the thread couldn't be created.
+ */
+EEWatchdog *
+ee_watchdog_new (guint interval, guint threshold, gboolean capture_stack)
+{
+    EEWatchdog *watchdog;
+    GError *error = NULL;
+
+    watchdog = g_new0 (EEWatchdog, 1);
+    watchdog->interval = MAX (interval, 10);
+    watchdog->threshold = MAX (threshold, watchdog->interval);
+    watchdog->capture_stack = capture_stack;
+    watchdog->latency.bounds = latency_bounds;
+    watchdog->lock = g_mutex_new ();
+    watchdog->cond = g_cond_new ();
+    main_thread = pthread_self ();
+
+#ifdef HAVE_EXECINFO_H
+    if (capture_stack) {
+        struct sigaction action;
+        void *frame;
+
+        /* the first call loads libgcc, which mustn't happen in the handler */
+        backtrace (&frame, 1);
+        memset (&action, 0, sizeof (action));
+        action.sa_handler = on_backtrace_signal;
+        action.sa_flags = SA_RESTART;
+        sigemptyset (&action.sa_mask);
+        sigaction (SIGUSR1, &action, NULL);
+    }
+#else
+    if (capture_stack)
+        g_warning ("stack capture isn't supported on this platform");
+#endif
+
+    watchdog->thread = g_thread_create ((GThreadFunc) watchdog_thread, watchdog, TRUE, &error);
+    if (watchdog->thread == NULL) {
+        g_critical ("failed to start watchdog thread: %s", error->message);
+        g_error_free (error);
+        g_mutex_free (watchdog->lock);
+        g_cond_free (watchdog->cond);
+        g_free (watchdog);
+        return NULL;
+    }
+    g_debug ("watching the main loop every %u ms", watchdog->interval);
+    return watchdog;
+}
+
+/*
+ * ee_watchdog_free: stop the watchdog thread and free the watchdog.
+ */
+void
+ee_watchdog_free (EEWatchdog *watchdog)
+{
+    g_mutex_lock (watchdog->lock);
+    watchdog->stopping = TRUE;
+    g_cond_signal (watchdog->cond);
+    g_mutex_unlock (watchdog->lock);
+    g_thread_join (watchdog->thread);
+
+    if (watchdog->ping_id > 0)
+        g_source_remove (watchdog->ping_id);
+    if (watchdog->capture_stack)
+        signal (SIGUSR1, SIG_DFL);
+    g_debug ("main loop latency: %" G_GUINT64_FORMAT " pings, max %" G_GINT64_FORMAT
+        " ms, %u stalls", watchdog->latency.count, watchdog->max_latency / 1000,
+        watchdog->stalls);
+    g_mutex_free (watchdog->lock);
+    g_cond_free (watchdog->cond);
+    g_free (watchdog);
+}
@@ -0,0 +1,26 @@
+#ifndef EE_WATCHDOG_H
+#define EE_WATCHDOG_H
+
+#include <glib.h>
+#include <ee-metrics.h>
+
+typedef struct {
+    GThread *thread;
+    GMutex *lock;
+    GCond *cond;
+    guint interval;
+    guint threshold;
+    gboolean capture_stack;
+    gboolean stopping;
+    guint ping_id;
+    gint64 ping_sent;
+    gboolean stall_reported;
+    EEHistogram latency;
+    gint64 max_latency;
+    guint stalls;
+} EEWatchdog;
+
+EEWatchdog *ee_watchdog_new (guint interval, guint threshold, gboolean capture_stack);
+void ee_watchdog_free (EEWatchdog *watchdog);
+
+#endif